@@ -5,10 +5,30 @@ struct Location
 {
     float lattitude, longitude;
 };
+// Ringkasan satu window sampel heart rate
+struct HRSummary
+{
+    uint8_t min, max, mean, last, count;
+};
+// Posisi GPS: keyframe absolut, atau delta (unit 1e-5 derajat) terhadap
+// keyframe dengan key yang sama
+struct LocationKeyframe
+{
+    Location location;
+    uint8_t key;
+};
+struct LocationDelta
+{
+    int16_t dlat, dlon;
+    uint8_t key;
+};
 union SensorData
 {
     uint8_t value;
     Location location;
+    HRSummary summary;
+    LocationKeyframe keyframe;
+    LocationDelta delta;
 };
 enum class Topic : uint8_t
 {
@@ -16,9 +36,38 @@ enum class Topic : uint8_t
     SPO2=2,
     STRESS=3,
     GPS=4,
-    SOS=5
+    SOS=5,
+    HEART_RATE_SUMMARY=6,
+    GPS_KEYFRAME=7,
+    GPS_DELTA=8
 };
 
+// Nama topic untuk log, MQTT dan API (string konstan, tanpa alokasi)
+inline const char *topicName(Topic topic)
+{
+    switch (topic)
+    {
+    case Topic::HEART_RATE:
+        return "heart_rate";
+    case Topic::SPO2:
+        return "spo2";
+    case Topic::STRESS:
+        return "stress";
+    case Topic::GPS:
+        return "GPS";
+    case Topic::SOS:
+        return "SOS";
+    case Topic::HEART_RATE_SUMMARY:
+        return "heart_rate_summary";
+    case Topic::GPS_KEYFRAME:
+        return "GPS_keyframe";
+    case Topic::GPS_DELTA:
+        return "GPS_delta";
+    default:
+        return "unknown";
+    }
+}
+
 struct DeviceData
 {
     SensorData sensor;
@@ -26,10 +75,50 @@ struct DeviceData
     Topic topic;
 };
 
+// Pembacaan yang menunggu dikirim ke API (antrian uplink / journal)
+struct UplinkItem
+{
+    DeviceData data;
+    uint32_t timestamp; // epoch detik saat diterima base
+};
+
+// SOS di jalur prioritas base, rxTick = millis() saat frame LoRa diterima
+struct SosItem
+{
+    UplinkItem item;
+    uint32_t rxTick;
+};
+
+// Budget latensi SOS per bagian jalur. Jam client dan base tidak
+// sinkron, jadi end-to-end (tombol -> POST) = jumlah kedua bagian.
+static const uint32_t SOS_LORA_BUDGET_MS = 2000;   // client: tombol -> ACK base
+static const uint32_t SOS_UPLINK_BUDGET_MS = 1000; // base: frame diterima -> POST/publish
+struct SosLatency
+{
+    uint32_t delivered = 0;
+    uint32_t lastMs = 0;
+    uint32_t maxMs = 0;
+    uint32_t overBudget = 0;
+    uint64_t totalMs = 0;
+
+    void record(uint32_t ms, uint32_t budgetMs)
+    {
+        delivered++;
+        lastMs = ms;
+        totalMs += ms;
+        if (ms > maxMs)
+            maxMs = ms;
+        if (ms > budgetMs)
+            overBudget++;
+    }
+    uint32_t avgMs() const { return delivered ? (uint32_t)(totalMs / delivered) : 0; }
+};
+
 struct GPSData
 {
     float lattitude;
     float longitude;
+    float speed_kmph;
     bool isNew;
 };
 #endif
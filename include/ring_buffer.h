@@ -0,0 +1,79 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+#include <stddef.h>
+#include <atomic>
+
+// Ring buffer single-producer / single-consumer tanpa lock.
+// Producer hanya memanggil push(), consumer hanya memanggil pop()/peek().
+// Kapasitas efektif N - 1 elemen.
+template <typename T, size_t N>
+class RingBuffer
+{
+public:
+    bool push(const T &item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t next = (head + 1) % N;
+        if (next == tail_.load(std::memory_order_acquire))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return false;
+        item = items[tail];
+        tail_.store((tail + 1) % N, std::memory_order_release);
+        return true;
+    }
+
+    // Akses elemen terdepan tanpa mengeluarkannya (hanya dari consumer)
+    T *peek()
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return nullptr;
+        return &items[tail];
+    }
+
+    // Akses elemen ke-i dari depan (hanya dari consumer)
+    T *at(size_t i)
+    {
+        if (i >= size())
+            return nullptr;
+        return &items[(tail_.load(std::memory_order_relaxed) + i) % N];
+    }
+
+    void discard()
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail != head_.load(std::memory_order_acquire))
+            tail_.store((tail + 1) % N, std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return (head + N - tail) % N;
+    }
+
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() == N - 1; }
+    static constexpr size_t capacity() { return N - 1; }
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    T items[N];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
+#endif
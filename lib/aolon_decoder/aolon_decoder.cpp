@@ -0,0 +1,83 @@
+#include "aolon_decoder.h"
+#include <string.h>
+
+AolonDecoder::AolonDecoder(const AolonCommand *table, size_t count, void *ctx, AolonHandler unknown)
+    : table(table), ctx(ctx), unknown(unknown), fill(0), lastFeed(0)
+{
+    memset(lookup, 0, sizeof(lookup));
+    memset(&counters, 0, sizeof(counters));
+    // Entri pertama menang jika ada cmd ganda; tabel maksimal 255 entri
+    for (size_t i = count; i > 0; i--)
+    {
+        if (i <= 0xFF)
+            lookup[table[i - 1].cmd] = (uint8_t)i;
+    }
+}
+
+void AolonDecoder::resync()
+{
+    size_t skip = 1;
+    while (skip < fill && buf[skip] != AOLON_SYNC0)
+        skip++;
+    counters.discarded += skip;
+    fill -= skip;
+    memmove(buf, buf + skip, fill);
+}
+
+void AolonDecoder::dispatch()
+{
+    AolonFrame frame;
+    frame.cmd = buf[4];
+    frame.payload = buf + AOLON_HEADER_LEN;
+    frame.len = buf[3] - AOLON_HEADER_LEN;
+
+    uint8_t idx = lookup[frame.cmd];
+    if (!idx)
+    {
+        counters.unknown++;
+        if (unknown)
+            unknown(ctx, frame);
+        return;
+    }
+    if (table[idx - 1].handler(ctx, frame))
+        counters.frames++;
+    else
+        counters.malformed++;
+}
+
+void AolonDecoder::feed(const uint8_t *data, size_t len, uint32_t now)
+{
+    if (fill && now - lastFeed > AOLON_FRAME_GAP_MS)
+    {
+        counters.discarded += fill;
+        fill = 0;
+    }
+    lastFeed = now;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[fill++] = data[i];
+
+        // Validasi header setiap ada byte baru; setelah resync byte yang
+        // tersisa di buffer dicek ulang
+        while (fill)
+        {
+            if (buf[0] != AOLON_SYNC0 || (fill >= 2 && buf[1] != AOLON_SYNC1) ||
+                (fill >= 4 && (buf[3] < AOLON_HEADER_LEN || buf[3] > AOLON_MAX_FRAME)))
+            {
+                resync();
+                continue;
+            }
+            // Setelah resync buffer bisa berisi lebih dari satu frame
+            if (fill >= AOLON_HEADER_LEN && fill >= buf[3])
+            {
+                size_t n = buf[3];
+                dispatch();
+                fill -= n;
+                memmove(buf, buf + n, fill);
+                continue;
+            }
+            break;
+        }
+    }
+}
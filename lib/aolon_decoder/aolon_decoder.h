@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// ===========================================
+// Decoder frame protokol Aolon (FE EA)
+// ===========================================
+// Frame dari karakteristik notify FEE3:
+//
+//   [FE][EA][20][len][cmd][payload...]
+//
+// len = panjang seluruh frame termasuk header. Satu frame bisa terpecah
+// di beberapa notifikasi dan satu notifikasi bisa berisi beberapa frame,
+// jadi byte diumpankan sebagai stream lalu frame lengkap di-dispatch
+// berdasarkan cmd lewat tabel handler.
+//
+// Tidak bergantung Arduino supaya bisa diuji dan di-fuzz di host.
+static constexpr uint8_t AOLON_SYNC0 = 0xFE;
+static constexpr uint8_t AOLON_SYNC1 = 0xEA;
+static constexpr size_t AOLON_HEADER_LEN = 5;
+static constexpr size_t AOLON_MAX_FRAME = 64;
+// Sisa frame yang tidak dilanjutkan dalam selang ini dibuang, supaya
+// notifikasi yang hilang tidak menelan frame berikutnya
+static constexpr uint32_t AOLON_FRAME_GAP_MS = 200;
+
+struct AolonFrame
+{
+    uint8_t cmd;
+    const uint8_t *payload; // byte setelah cmd
+    size_t len;             // panjang payload
+};
+
+// Return false jika payload tidak sesuai (dihitung sebagai malformed)
+typedef bool (*AolonHandler)(void *ctx, const AolonFrame &frame);
+
+struct AolonCommand
+{
+    uint8_t cmd;
+    AolonHandler handler;
+};
+
+struct AolonDecoderStats
+{
+    uint32_t frames;    // frame lengkap yang di-dispatch
+    uint32_t unknown;   // cmd tidak ada di tabel
+    uint32_t malformed; // handler menolak payload
+    uint32_t discarded; // byte dibuang saat mencari header / frame basi
+};
+
+class AolonDecoder
+{
+public:
+    // table disimpan sebagai pointer (biasanya static const). unknown
+    // dipanggil untuk cmd yang tidak ada di tabel, boleh nullptr.
+    AolonDecoder(const AolonCommand *table, size_t count, void *ctx, AolonHandler unknown = nullptr);
+
+    void feed(const uint8_t *data, size_t len, uint32_t now);
+    // Buang frame yang belum lengkap (mis. saat disconnect)
+    void reset() { fill = 0; }
+
+    AolonDecoderStats stats() const { return counters; }
+
+private:
+    const AolonCommand *table;
+    void *ctx;
+    AolonHandler unknown;
+    // cmd -> index tabel + 1, 0 = tidak dikenal
+    uint8_t lookup[256];
+
+    uint8_t buf[AOLON_MAX_FRAME];
+    size_t fill;
+    uint32_t lastFeed;
+    AolonDecoderStats counters;
+
+    // Buang byte pertama lalu geser ke kandidat header berikutnya
+    void resync();
+    void dispatch();
+};
@@ -1,8 +1,8 @@
 #include "ble_manager.h"
 #include <cstring>
-#include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
-BLEManager *BLEManager::instance = nullptr;
+BLEManager *BLEManager::managers[BLE_MAX_WEARERS] = {};
+size_t BLEManager::managerCount = 0;
+TaskHandle_t BLEManager::reconnectHandle = nullptr;
 
 // UUID service & characteristic Aolon Curve
 static const BLEUUID GENERIC_SERVICE("0000feea-0000-1000-8000-00805f9b34fb");
@@ -10,16 +10,70 @@ static const BLEUUID CHAR_WRITE("0000fee2-0000-1000-8000-00805f9b34fb");
 static const BLEUUID CHAR_NOTIFY("0000fee3-0000-1000-8000-00805f9b34fb");
 static const BLEUUID HR_SERVICE("0000180d-0000-1000-8000-00805f9b34fb");
 static const BLEUUID HR_NOTIFY_CHAR("00002a37-0000-1000-8000-00805f9b34fb");
+static const BLEUUID CCCD_UUID((uint16_t)0x2902);
 
-BLEManager::BLEManager(const char *targetAddress, uint32_t scanTime)
-    : targetAddress(targetAddress),
+// Perintah ke band, index = BLECommand. Respons dikenali dari cmd frame
+// di handler FRAME_HANDLERS.
+struct BLECommandSpec
+{
+    const char *name;
+    uint8_t cmd[8];
+    uint8_t cmdLen;
+};
+
+static const BLECommandSpec COMMANDS[(size_t)BLECommand::COUNT] = {
+    {"SPO2", {0xFE, 0xEA, 0x20, 0x06, 0x6B, 0x00}, 6},
+    {"STRESS", {0xFE, 0xEA, 0x20, 0x08, 0xB9, 0x01, 0x00, 0x00}, 8},
+};
+
+// Handler frame FE EA per cmd. Pengukuran lain dari band (langkah, suhu,
+// tekanan darah, baterai) cukup ditambah satu baris di sini, handler yang
+// memanggil pushSample dengan Topic baru, dan BLECommand jika perlu trigger.
+const AolonCommand BLEManager::FRAME_HANDLERS[] = {
+    {0x6B, &BLEManager::onSpO2Frame},
+    {0xB9, &BLEManager::onStressFrame},
+};
+
+BLEManager::BLEManager(const char *targetAddress, uint8_t deviceId, uint32_t scanTime)
+    : target(targetAddress),
+      targetType(BLE_ADDR_TYPE_PUBLIC),
+      wearerId(deviceId),
       scanTime(scanTime),
       deviceConnected(false),
-      lastReconnectAttempt(0),
+      ready(false),
+      nextReconnectAt(0),
+      reconnectBackoff(BLE_RECONNECT_MIN_MS),
       pClient(nullptr),
+      handles{},
+      persistCache(false),
+      cacheStale(false),
+      gattDone(nullptr),
+      gattStatus(ESP_GATT_OK),
+      disconnectTick(0),
+      connectAttempts(0),
+      connectDirect(0),
+      connectScanned(0),
+      connectFailed(0),
+      connectCached(0),
+      connectDiscoveries(0),
+      connectLastMs(0),
+      connectMaxMs(0),
+      connectGapMs(0),
+      connectTotalMs(0),
+      inflight(BLECommand::SPO2),
+      inflightActive(false),
+      inflightTries(0),
+      inflightFirstTick(0),
+      inflightSentTick(0),
+      awaiting(-1),
+      responseTick(0),
+      responded(false),
+      cmdStats{},
+      cmdTotalMs(0),
+      scanCb(this),
+      decoder(FRAME_HANDLERS, sizeof(FRAME_HANDLERS) / sizeof(FRAME_HANDLERS[0]), this, &BLEManager::onUnknownFrame),
       clientCb(this)
 {
-    instance = this;
 }
 
 // ===========================================
@@ -28,124 +82,250 @@ BLEManager::BLEManager(const char *targetAddress, uint32_t scanTime)
 void BLEManager::MyClientCallback::onConnect(BLEClient *)
 {
     parent_->deviceConnected = true;
-    parent_->lastReconnectAttempt = 0;
-    Serial.println("[BLE] Connected");
+    Serial.printf("[BLE] Wearer %u connected\n", parent_->wearerId);
 }
 
 void BLEManager::MyClientCallback::onDisconnect(BLEClient *)
 {
-    // remove service and characteristic
+    // Handle GATT tidak dihapus, dipakai lagi saat reconnect
     parent_->deviceConnected = false;
-    parent_->pGenericService = nullptr;
-    parent_->pHRRemoteService = nullptr;
-    parent_->pGenericWriteCharacteristic = nullptr;
-    parent_->pGenericNotifyCharacteristic = nullptr;
-    parent_->pHRNotifyCharacteristic = nullptr;
-    Serial.println("[BLE] Disconnected");
+    parent_->ready = false;
+    parent_->decoder.reset();
+    parent_->disconnectTick = millis();
+    // Percobaan pertama setelah putus langsung jalan
+    parent_->nextReconnectAt = parent_->disconnectTick;
+    parent_->reconnectBackoff = BLE_RECONNECT_MIN_MS;
+    if (reconnectHandle)
+        xTaskNotifyGive(reconnectHandle);
+    Serial.printf("[BLE] Wearer %u disconnected\n", parent_->wearerId);
     delay(300); // beri waktu cleanup stack BLE internal
 }
 
 // ===========================================
 // Scan dan koneksi
 // ===========================================
-BLEAddress BLEManager::scanTarget()
+void BLEManager::TargetScanCallback::onResult(BLEAdvertisedDevice dev)
+{
+    if (found || !dev.getAddress().equals(parent_->target))
+        return;
+    found = true;
+    parent_->targetType = dev.getAddressType();
+    // start() yang blocking langsung kembali
+    BLEDevice::getScan()->stop();
+}
+
+// Scan pasif sampai advertisement pertama dari target (paling lama scanTime)
+bool BLEManager::scanTarget()
 {
     BLEScan *scan = BLEDevice::getScan();
-    scan->setActiveScan(true);
+    scan->setAdvertisedDeviceCallbacks(&scanCb, false);
+    scan->setActiveScan(false);
+    scan->setInterval(100);
+    scan->setWindow(99);
+    scanCb.found = false;
     Serial.println("[BLE] Scanning for target...");
-    BLEScanResults results = scan->start(scanTime, false);
-    Serial.printf("[BLE] Found %d devices\n", results.getCount());
-
-    strlwr((char *)targetAddress);
-
-    for (int i = 0; i < results.getCount(); ++i)
+    uint32_t start = millis();
+    scan->start(scanTime, false);
+    scan->clearResults();
+    if (!scanCb.found)
     {
-        BLEAdvertisedDevice dev = results.getDevice(i);
-        char *addr = (char *) dev.getAddress().toString().c_str();
-        strlwr(addr);
-        if (strcmp(targetAddress, addr) == 0)
-        {
-            Serial.printf("[BLE] Found target %s\n", addr);
-            return dev.getAddress();
-        }
+        Serial.println("[BLE] Device not found");
+        return false;
     }
-    Serial.println("[BLE] Device not found");
-    return BLEAddress("");
+    Serial.printf("[BLE] Found target after %lu ms\n", millis() - start);
+    return true;
 }
 
-void BLEManager::begin(const char *deviceName)
+void BLEManager::begin(const char *deviceName, bool persistGattCache)
 {
+    if (managerCount >= BLE_MAX_WEARERS)
+    {
+        Serial.printf("[BLE] Max %u wearers, %s ignored\n", (unsigned)BLE_MAX_WEARERS, target.toString().c_str());
+        return;
+    }
+    managers[managerCount++] = this;
+    persistCache = persistGattCache;
+    gattDone = xSemaphoreCreateBinary();
     // BLEDevice::deinit(true);
     // delay(200);
     BLEDevice::init(deviceName);
-    delay(200);
-    connect();
+    BLEDevice::setCustomGattcHandler(&BLEManager::gattcEvent);
+    // Client dibuat di sini supaya gattcEvent tidak membaca pClient yang
+    // sedang diisi task connect
+    pClient = BLEDevice::createClient();
+    pClient->setClientCallbacks(&clientCb);
+    if (!reconnectHandle &&
+        xTaskCreatePinnedToCore(reconnectTask, "BLE connect", 8192, nullptr, 1, &reconnectHandle, 0) != pdPASS)
+    {
+        reconnectHandle = nullptr;
+        Serial.println("[BLE] Failed to start connect task");
+        return;
+    }
+    xTaskNotifyGive(reconnectHandle);
 }
 
 bool BLEManager::connect()
 {
-    BLEAddress addr = scanTarget();
-    if (!addr.toString().length())
-    {
-        Serial.println("[BLE] Device not found during scan");
-        return false;
-    }
-
-    if (!pClient)
-        pClient = BLEDevice::createClient();
-    if (pClient->isConnected())
+    if (isReady())
     {
         Serial.println("[BLE] Device has already connected");
         return true;
     }
 
-    pClient->setClientCallbacks(&clientCb);
+    uint32_t start = millis();
+    connectAttempts++;
+    // Alamat target sudah diketahui, scan hanya jika connect langsung gagal
+    // (band tidak advertising, atau tipe alamat berbeda). Link yang masih
+    // hidup setelah setupNotify gagal dipakai lagi.
+    bool scanned = false;
+    if (!isConnected())
+    {
+        Serial.printf("[BLE] Connecting to %s...\n", target.toString().c_str());
+        if (!pClient->connect(target, targetType, BLE_CONNECT_TIMEOUT_MS))
+        {
+            Serial.println("[BLE] Direct connect failed, falling back to scan");
+            scanned = true;
+            if (!scanTarget() || !pClient->connect(target, targetType, BLE_CONNECT_TIMEOUT_MS))
+            {
+                Serial.println("[BLE] Connect failed");
+                connectFailed++;
+                return false;
+            }
+        }
+        deviceConnected = true;
+        Serial.printf("[BLE] Connected to server\n");
+    }
 
-    Serial.printf("[BLE] Connecting to %s...\n", addr.toString().c_str());
-    if (!pClient->connect(addr))
+    uint32_t cachedBefore = connectCached;
+    if (!setupNotify())
     {
-        Serial.println("[BLE] Connect failed");
+        connectFailed++;
         return false;
     }
+    ready = true;
 
-    deviceConnected = true;
-    Serial.printf("[BLE] Connected to server\n");
+    uint32_t now = millis();
+    connectLastMs = now - start;
+    connectTotalMs += connectLastMs;
+    if (connectLastMs > connectMaxMs)
+        connectMaxMs = connectLastMs;
+    if (scanned)
+        connectScanned++;
+    else
+        connectDirect++;
+    if (disconnectTick)
+        connectGapMs = now - disconnectTick;
+    Serial.printf("[BLE] Wearer %u ready in %lu ms (%s, %s)", wearerId, connectLastMs, scanned ? "scan" : "direct",
+                  connectCached != cachedBefore ? "cached handles" : "discovery");
+    if (disconnectTick)
+        Serial.printf(", %lu ms since disconnect", connectGapMs);
+    Serial.println();
+    return true;
+}
 
-// Tampilkan daftar service untuk debug
-#ifdef DEBUG
-    std::map<std::string, BLERemoteService *> *services = pClient->getServices();
-    if (services && !services->empty())
+BLEReconnectStats BLEManager::reconnectStats() const
+{
+    BLEReconnectStats s;
+    s.attempts = connectAttempts;
+    s.direct = connectDirect;
+    s.scanned = connectScanned;
+    s.failed = connectFailed;
+    s.cached = connectCached;
+    s.discoveries = connectDiscoveries;
+    s.lastMs = connectLastMs;
+    uint32_t ok = connectDirect + connectScanned;
+    s.avgMs = ok ? (uint32_t)(connectTotalMs / ok) : 0;
+    s.maxMs = connectMaxMs;
+    s.lastGapMs = connectGapMs;
+    return s;
+}
+
+// ===========================================
+// Reconnect handler
+// ===========================================
+void BLEManager::reconnectTask(void *)
+{
+    while (true)
     {
-        Serial.println("[BLE] Services discovered: ");
-        for (auto &s : *services)
-            Serial.println(s.first.c_str());
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BLE_RECONNECT_MIN_MS));
+        for (size_t i = 0; i < managerCount; i++)
+            managers[i]->reconnectIfDue();
     }
-    else
+}
+
+bool BLEManager::reconnectIfDue()
+{
+    if (isReady() || (int32_t)(millis() - nextReconnectAt) < 0)
+        return false;
+    bool ok = connect();
+    if (ok)
     {
-        Serial.println("[BLE] No services discovered (may still work)");
+        reconnectBackoff = BLE_RECONNECT_MIN_MS;
+        return true;
     }
-#endif
+    // Jeda dihitung dari akhir percobaan, supaya band yang tidak ada tidak
+    // membuat task terus-menerus connect/scan
+    nextReconnectAt = millis() + reconnectBackoff;
+    Serial.printf("[BLE] Wearer %u retry in %lu ms\n", wearerId, reconnectBackoff);
+    reconnectBackoff = min(reconnectBackoff * 2, BLE_RECONNECT_MAX_MS);
+    return false;
+}
 
-    delay(500);
-    if (!setupServicesAndCharacteristics())
-        return false;
-    enableNotify(pGenericService, pGenericNotifyCharacteristic, &BLEManager::notifyThunk);
-    enableNotify(pHRRemoteService, pHRNotifyCharacteristic, &BLEManager::HRNotifyCallback);
-    return true;
+bool BLEManager::tryReconnect()
+{
+    if (isReady())
+        return true;
+    if (reconnectHandle)
+        xTaskNotifyGive(reconnectHandle);
+    return false;
 }
 
 // ===========================================
-// Reconnect handler
+// GATT: cache handle dan discovery
 // ===========================================
-bool BLEManager::tryReconnect()
+bool BLEManager::setupNotify()
 {
-    unsigned long now = millis();
-    if (!deviceConnected && (now - lastReconnectAttempt >= reconnectInterval))
+    const uint8_t *addr = *target.getNative();
+    if (cacheStale)
     {
-        lastReconnectAttempt = now;
-        return connect();
+        invalidateGattCache();
+        cacheStale = false;
     }
-    return false;
+    if (!handles.valid() && persistCache && GattCache::load(addr, handles))
+        Serial.println("[BLE] GATT handles loaded from NVS");
+
+    // Validasi murah: CCCD ditulis dengan respons, handle yang sudah tidak
+    // cocok ditolak band (invalid handle / write not permitted)
+    if (handles.valid())
+    {
+        if (enableNotify(handles.notify, handles.notifyCccd) &&
+            enableNotify(handles.hrNotify, handles.hrCccd))
+        {
+            connectCached++;
+            return true;
+        }
+        if (!isConnected())
+            return false;
+        Serial.println("[BLE] Cached GATT handles rejected, rediscovering");
+        invalidateGattCache();
+    }
+
+    if (!setupServicesAndCharacteristics())
+        return false;
+    connectDiscoveries++;
+    if (!enableNotify(handles.notify, handles.notifyCccd) ||
+        !enableNotify(handles.hrNotify, handles.hrCccd))
+        return false;
+    if (persistCache && !GattCache::store(addr, handles))
+        Serial.println("[BLE] Failed to store GATT handles");
+    return true;
+}
+
+void BLEManager::invalidateGattCache()
+{
+    memset(&handles, 0, sizeof(handles));
+    if (persistCache)
+        GattCache::erase(*target.getNative());
 }
 
 bool BLEManager::setupServicesAndCharacteristics()
@@ -156,48 +336,77 @@ bool BLEManager::setupServicesAndCharacteristics()
         return false;
     }
 
-    pHRRemoteService = pClient->getService(HR_SERVICE);
-    if (!pHRRemoteService)
+// Tampilkan daftar service untuk debug
+#ifdef DEBUG
+    std::map<std::string, BLERemoteService *> *services = pClient->getServices();
+    if (services && !services->empty())
+    {
+        Serial.println("[BLE] Services discovered: ");
+        for (auto &s : *services)
+            Serial.println(s.first.c_str());
+    }
+    else
+    {
+        Serial.println("[BLE] No services discovered (may still work)");
+    }
+#endif
+
+    BLERemoteService *hrService = pClient->getService(HR_SERVICE);
+    if (!hrService)
     {
         Serial.println("[BLE] Heart Rate service not found");
         return false;
     }
-    pGenericService = pClient->getService(GENERIC_SERVICE);
-    if (!pGenericService)
+    BLERemoteService *genericService = pClient->getService(GENERIC_SERVICE);
+    if (!genericService)
     {
         Serial.println("[BLE] Generic service not found");
         return false;
     }
 
-    pHRNotifyCharacteristic = pHRRemoteService->getCharacteristic(HR_NOTIFY_CHAR);
-    if (!pHRNotifyCharacteristic)
+    BLERemoteCharacteristic *hrNotify = hrService->getCharacteristic(HR_NOTIFY_CHAR);
+    if (!hrNotify)
     {
         Serial.println("[BLE] HR Notify characteristic not found");
         return false;
     }
 
-    pGenericWriteCharacteristic = pGenericService->getCharacteristic(CHAR_WRITE);
-    if (!pGenericWriteCharacteristic)
+    BLERemoteCharacteristic *genericWrite = genericService->getCharacteristic(CHAR_WRITE);
+    if (!genericWrite)
     {
         Serial.println("[BLE] Generic Write characteristic not found");
         return false;
     }
 
-    pGenericNotifyCharacteristic = pGenericService->getCharacteristic(CHAR_NOTIFY);
-    if (!pGenericNotifyCharacteristic)
+    BLERemoteCharacteristic *genericNotify = genericService->getCharacteristic(CHAR_NOTIFY);
+    if (!genericNotify)
     {
         Serial.println("[BLE] Generic Notify characteristic not found");
         return false;
     }
 
-    Serial.println("[BLE] Services and characteristics setup complete");
+    BLERemoteDescriptor *hrCccd = hrNotify->getDescriptor(CCCD_UUID);
+    BLERemoteDescriptor *notifyCccd = genericNotify->getDescriptor(CCCD_UUID);
+    if (!hrCccd || !notifyCccd)
+    {
+        Serial.println("[BLE] Notify descriptor not found");
+        return false;
+    }
+
+    handles.hrNotify = hrNotify->getHandle();
+    handles.hrCccd = hrCccd->getHandle();
+    handles.write = genericWrite->getHandle();
+    handles.notify = genericNotify->getHandle();
+    handles.notifyCccd = notifyCccd->getHandle();
+
+    Serial.printf("[BLE] Services and characteristics setup complete (write:0x%04x notify:0x%04x hr:0x%04x)\n",
+                  handles.write, handles.notify, handles.hrNotify);
     return true;
 }
 
 bool BLEManager::checkServicesAndCharacteristics()
 {
-    if (!pHRRemoteService || !pGenericService ||
-        !pHRNotifyCharacteristic || !pGenericWriteCharacteristic || !pGenericNotifyCharacteristic)
+    if (!handles.valid())
     {
         Serial.println("[BLE] Services or characteristics not properly set up");
         return false;
@@ -209,134 +418,254 @@ bool BLEManager::checkServicesAndCharacteristics()
 // ===========================================
 // Enable notify function
 // ===========================================
-bool BLEManager::enableNotify(BLERemoteService *service, BLERemoteCharacteristic *characteristic, void (*callback)(BLERemoteCharacteristic *, uint8_t *, size_t, bool))
+bool BLEManager::enableNotify(uint16_t charHandle, uint16_t cccdHandle)
 {
-    if (!service)
+    if (!isConnected() || !charHandle || !cccdHandle)
     {
-        Serial.println("[BLE] Service Uninitialized");
+        Serial.println("[BLE] Characteristic Uninitialized");
         return false;
     }
-    if (!characteristic)
+
+    uint8_t notifyOn[] = {0x01, 0x00};
+    xSemaphoreTake(gattDone, 0);
+    gattStatus = ESP_GATT_ERROR;
+    if (esp_ble_gattc_write_char_descr(pClient->getGattcIf(), pClient->getConnId(), cccdHandle,
+                                       sizeof(notifyOn), notifyOn, ESP_GATT_WRITE_TYPE_RSP,
+                                       ESP_GATT_AUTH_REQ_NONE) != ESP_OK)
+        return false;
+    if (xSemaphoreTake(gattDone, pdMS_TO_TICKS(BLE_GATT_TIMEOUT_MS)) != pdTRUE)
     {
-        Serial.println("[BLE] Characteristic Uninitialized");
+        Serial.println("[BLE] Notify descriptor write timeout");
+        return false;
     }
-
-    BLERemoteDescriptor *desc = characteristic->getDescriptor(BLEUUID((uint16_t)0x2902));
-    if (!desc)
+    if (gattStatus != ESP_GATT_OK)
     {
-        Serial.println("[BLE] Notify descriptor not found");
+        Serial.printf("[BLE] Notify descriptor 0x%04x rejected: %d\n", cccdHandle, gattStatus);
         return false;
     }
-    uint8_t notifyOn[] = {0x01, 0x00};
-    desc->writeValue(notifyOn, sizeof(notifyOn), true);
+    esp_ble_gattc_register_for_notify(pClient->getGattcIf(), *target.getNative(), charHandle);
     Serial.println("[BLE] Notify enabled");
-    characteristic->registerForNotify(callback);
     return true;
 }
 
-// ===========================================
-// Perintah trigger sensor
-// ===========================================
-bool BLEManager::triggerSpO2()
+bool BLEManager::writeCommand(const uint8_t *data, size_t len)
 {
-    static const uint8_t cmd[] = {0xFE, 0xEA, 0x20, 0x06, 0x6B, 0x00};
-    delay(150);
-    if (pGenericWriteCharacteristic == nullptr)
+    if (!isConnected() || !handles.write)
     {
         Serial.println("[BLE] Generic Write Characterristic Uninitialized");
         return false;
     }
-    pGenericWriteCharacteristic->writeValue((uint8_t *)cmd, sizeof(cmd));
-    Serial.println("[BLE] Trigger SPO2 sent");
-    return true;
+    return esp_ble_gattc_write_char(pClient->getGattcIf(), pClient->getConnId(), handles.write,
+                                    len, (uint8_t *)data, ESP_GATT_WRITE_TYPE_NO_RSP,
+                                    ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
 }
 
-bool BLEManager::triggerStress()
+// ===========================================
+// Scheduler perintah sensor
+// ===========================================
+bool BLEManager::queueCommand(BLECommand cmd)
 {
-    static const uint8_t cmd[] = {0xFE, 0xEA, 0x20, 0x08, 0xB9, 0x01, 0x00, 0x00};
-    delay(150);
-    if (pGenericWriteCharacteristic == nullptr)
+    if (inflightActive && inflight == cmd)
+        return true;
+    for (size_t i = 0; i < commands.size(); i++)
     {
-        Serial.println("[BLE] Generic Write Characterristic Uninitialized");
+        if (*commands.at(i) == cmd)
+            return true;
+    }
+    if (!commands.push(cmd))
+    {
+        cmdStats.dropped++;
+        Serial.printf("[BLE] Command queue full, %s dropped\n", COMMANDS[(size_t)cmd].name);
         return false;
     }
-    pGenericWriteCharacteristic->writeValue((uint8_t *)cmd, sizeof(cmd));
-    Serial.println("[BLE] Trigger STRESS sent");
+    cmdStats.queued++;
     return true;
 }
 
-// ===========================================
-// Callback untuk data BLE masuk
-// ===========================================
-void BLEManager::notifyThunk(BLERemoteCharacteristic *ch, uint8_t *data, size_t len, bool)
+bool BLEManager::sendInflight(uint32_t now)
 {
-    if (len == 0 || !ch)
-        return;
+    const BLECommandSpec &spec = COMMANDS[(size_t)inflight];
+    inflightSentTick = now;
+    inflightTries++;
+    if (!writeCommand(spec.cmd, spec.cmdLen))
+        return false;
+    cmdStats.sent++;
+    Serial.printf("[BLE] Trigger %s sent to wearer %u (try %u)\n", spec.name, wearerId, inflightTries);
+    return true;
+}
 
-    char stress_prefix[] = {0xFE, 0xEA, 0x20, 0x08, 0xB9, 0x11, 0x00};
-    char spo2_prefix[] = {0xFE, 0xEA, 0x20, 0x06, 0x6B};
+void BLEManager::commandResponse(BLECommand cmd)
+{
+    if (awaiting != (int8_t)cmd)
+        return;
+    responseTick = millis();
+    awaiting = -1;
+    responded = true;
+}
 
-    // check prefix if stress
-    if (len == 8 && memcmp(data, stress_prefix, sizeof(stress_prefix)) == 0)
+void BLEManager::loop(uint32_t now)
+{
+    if (inflightActive)
     {
-        if (data[7] == 0xFF)
-            return;
+        if (responded)
+        {
+            uint32_t ms = responseTick - inflightFirstTick;
+            cmdStats.answered++;
+            cmdStats.lastMs = ms;
+            cmdTotalMs += ms;
+            if (ms > cmdStats.maxMs)
+                cmdStats.maxMs = ms;
+            inflightActive = false;
+        }
+        else if (now - inflightSentTick >= BLE_COMMAND_TIMEOUT_MS)
+        {
+            if (inflightTries >= BLE_COMMAND_MAX_TRIES)
+            {
+                awaiting = -1;
+                cmdStats.timeouts++;
+                inflightActive = false;
+                Serial.printf("[BLE] %s got no response from wearer %u\n", COMMANDS[(size_t)inflight].name, wearerId);
+            }
+            // Saat terputus percobaan tidak dihitung, dikirim ulang setelah reconnect
+            else if (isReady())
+            {
+                cmdStats.retries++;
+                sendInflight(now);
+            }
+        }
+    }
 
-        instance->Stress.data = data[7];
-        instance->Stress.isNew = true;
+    if (inflightActive || !isReady() || !commands.pop(inflight))
         return;
-    }
-    // check prefix if SpO2
-    if (len == 6 && memcmp(data, spo2_prefix, sizeof(spo2_prefix)) == 0)
+    inflightActive = true;
+    inflightTries = 0;
+    inflightFirstTick = now;
+    responded = false;
+    awaiting = (int8_t)inflight;
+    sendInflight(now);
+}
+
+BLECommandStats BLEManager::commandStats() const
+{
+    BLECommandStats s = cmdStats;
+    s.avgMs = s.answered ? (uint32_t)(cmdTotalMs / s.answered) : 0;
+    return s;
+}
+
+// ===========================================
+// Callback untuk data BLE masuk
+// ===========================================
+void BLEManager::gattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param)
+{
+    if (gattc_if == ESP_GATT_IF_NONE)
+        return;
+    BLEManager *self = nullptr;
+    for (size_t i = 0; i < managerCount; i++)
     {
-        if (data[5] == 0xFF)
-            return;
-        instance->SpO2.data = data[5];
-        instance->SpO2.isNew = true;
+        if (managers[i]->pClient && managers[i]->pClient->getGattcIf() == gattc_if)
+        {
+            self = managers[i];
+            break;
+        }
+    }
+    if (!self)
         return;
+
+    switch (event)
+    {
+    case ESP_GATTC_NOTIFY_EVT:
+        if (param->notify.handle == self->handles.notify)
+            self->onGenericNotify(param->notify.value, param->notify.value_len);
+        else if (param->notify.handle == self->handles.hrNotify)
+            self->onHRNotify(param->notify.value, param->notify.value_len);
+        break;
+    case ESP_GATTC_WRITE_DESCR_EVT:
+        self->gattStatus = param->write.status;
+        xSemaphoreGive(self->gattDone);
+        break;
+    case ESP_GATTC_SRVC_CHG_EVT:
+        // Firmware band berubah: handle cache tidak lagi berlaku
+        self->cacheStale = true;
+        break;
+    default:
+        break;
     }
+}
 
-    Serial.printf("[BLE] Unknown Data,len %d, data :%X \n", len, data);
+void BLEManager::onGenericNotify(const uint8_t *data, size_t len)
+{
+    decoder.feed(data, len, millis());
 }
 
-void BLEManager::HRNotifyCallback(BLERemoteCharacteristic *ch, uint8_t *data, size_t len, bool)
+// 0xFF = band menjawab tapi belum ada nilai
+bool BLEManager::onSpO2Frame(void *ctx, const AolonFrame &frame)
+{
+    BLEManager *self = static_cast<BLEManager *>(ctx);
+    if (frame.len != 1)
+        return false;
+    self->commandResponse(BLECommand::SPO2);
+    if (frame.payload[0] != 0xFF)
+        self->pushSample(Topic::SPO2, frame.payload[0]);
+    return true;
+}
+
+// payload: [11][00][nilai], 01 adalah perintah trigger
+bool BLEManager::onStressFrame(void *ctx, const AolonFrame &frame)
+{
+    BLEManager *self = static_cast<BLEManager *>(ctx);
+    if (frame.len != 3 || frame.payload[0] != 0x11 || frame.payload[1] != 0x00)
+        return false;
+    self->commandResponse(BLECommand::STRESS);
+    if (frame.payload[2] != 0xFF)
+        self->pushSample(Topic::STRESS, frame.payload[2]);
+    return true;
+}
+
+bool BLEManager::onUnknownFrame(void *, const AolonFrame &frame)
+{
+    Serial.printf("[BLE] Unknown frame cmd 0x%02X, %u bytes payload\n", frame.cmd, (unsigned)frame.len);
+    return true;
+}
+
+void BLEManager::onHRNotify(const uint8_t *data, size_t len)
 {
     // return if not valid
-    if (len == 0 || !ch)
+    if (len < 2)
         return;
     if (data[1] == 0xFF)
     {
         return;
     }
-    uint32_t now = millis();
-    instance->HR.data = data[1];
-    instance->HR.isNew = true;
+    pushSample(Topic::HEART_RATE, data[1]);
 }
 
-BLEData BLEManager::getLastSpO2()
+void BLEManager::pushSample(Topic topic, uint8_t value)
 {
-    BLEData copy = SpO2;
-    SpO2.isNew = false;
-    return copy;
+    BLESample sample;
+    sample.timestamp = millis();
+    sample.topic = topic;
+    sample.value = value;
+    samples.push(sample);
 }
-BLEData BLEManager::getLastStress()
+
+bool BLEManager::popSample(BLESample &sample)
 {
-    BLEData copy = Stress;
-    Stress.isNew = false;
-    return copy;
+    return samples.pop(sample);
 }
-BLEData BLEManager::getLastHR()
+
+size_t BLEManager::drainSamples(BLESample *out, size_t max)
 {
-    BLEData copy = HR;
-    HR.isNew = false;
-    return copy;
+    size_t n = 0;
+    while (n < max && samples.pop(out[n]))
+        n++;
+    return n;
 }
 
-DeviceData BLEManager::BLEDataToSensorData(uint8_t device_id, Topic topic, BLEData data)
+DeviceData BLEManager::sampleToDeviceData(uint8_t device_id, const BLESample &sample)
 {
     DeviceData dev_data={};
     dev_data.device_id = device_id;
-    dev_data.topic = topic;
-    dev_data.sensor.value = data.data;
+    dev_data.topic = sample.topic;
+    dev_data.sensor.value = sample.value;
     return dev_data;
 }
\ No newline at end of file
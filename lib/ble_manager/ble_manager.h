@@ -3,64 +3,209 @@
 #include <BLEDevice.h>
 #include <BLEUtils.h>
 #include <BLEScan.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "data.h"
+#include "ring_buffer.h"
+#include "gatt_cache.h"
+#include "aolon_decoder.h"
 
-// Struktur data BLE mentah terakhir
-struct BLEData
+// Satu sampel dari notifikasi BLE, diberi timestamp saat callback
+struct BLESample
 {
-    uint8_t data;
-    bool isNew;
+    uint32_t timestamp;
+    Topic topic;
+    uint8_t value;
 };
+static constexpr size_t BLE_SAMPLE_QUEUE_LEN = 33; // 32 sampel
+// Band yang bisa dilayani satu gateway (batas koneksi BLE Bluedroid)
+static constexpr size_t BLE_MAX_WEARERS = 3;
+// Connect langsung ke alamat target, tanpa scan
+static constexpr uint32_t BLE_CONNECT_TIMEOUT_MS = 2000;
+// Tunggu respons write CCCD
+static constexpr uint32_t BLE_GATT_TIMEOUT_MS = 1000;
+// Jeda antar percobaan reconnect per band, dihitung setelah percobaan
+// selesai: mulai BLE_RECONNECT_MIN_MS, dobel tiap gagal
+static constexpr uint32_t BLE_RECONNECT_MIN_MS = 1000;
+static constexpr uint32_t BLE_RECONNECT_MAX_MS = 60000;
 
+// Perintah ke band lewat karakteristik write FEE2. Responsnya datang di
+// notify FEE3 dan dicocokkan dengan prefix.
+enum class BLECommand : uint8_t
+{
+    SPO2,
+    STRESS,
+    COUNT
+};
+static constexpr size_t BLE_COMMAND_QUEUE_LEN = 5; // 4 perintah
+// Kirim ulang jika belum ada respons setelah timeout, paling banyak
+// BLE_COMMAND_MAX_TRIES kali
+static constexpr uint32_t BLE_COMMAND_TIMEOUT_MS = 1500;
+static constexpr uint8_t BLE_COMMAND_MAX_TRIES = 3;
+
+struct BLECommandStats
+{
+    uint32_t queued;
+    uint32_t sent;     // termasuk retry
+    uint32_t retries;
+    uint32_t answered;
+    uint32_t timeouts; // habis retry tanpa respons
+    uint32_t dropped;  // queue penuh
+    uint32_t lastMs;   // kirim pertama -> respons
+    uint32_t avgMs;
+    uint32_t maxMs;
+};
+
+struct BLEReconnectStats
+{
+    uint32_t attempts;
+    uint32_t direct;    // berhasil connect langsung ke alamat target
+    uint32_t scanned;   // berhasil setelah fallback scan
+    uint32_t failed;
+    uint32_t cached;      // notify aktif dari handle cache, tanpa discovery
+    uint32_t discoveries; // cache miss / handle cache ditolak
+    uint32_t lastMs;    // durasi connect() terakhir yang berhasil
+    uint32_t avgMs;
+    uint32_t maxMs;
+    uint32_t lastGapMs; // putus -> notify aktif lagi
+};
+
+// Connect, scan dan setup notify bisa makan beberapa detik per band, jadi
+// semuanya dijalankan satu task "BLE connect" untuk semua BLEManager,
+// bukan di loop(). Task bangun saat band putus atau tiap
+// BLE_RECONNECT_MIN_MS dan mencoba band yang jedanya sudah habis.
 class BLEManager
 {
 public:
-    explicit BLEManager(const char *targetAddress, uint32_t scanTime = 6);
-    void begin(const char *deviceName = "EoRa-S3-BLE");
+    // Satu BLEManager (dan satu BLEClient) per band. deviceId = device_id
+    // pemakai band di record yang dikirim.
+    BLEManager(const char *targetAddress, uint8_t deviceId, uint32_t scanTime = 6);
+    // persistGattCache: handle GATT juga disimpan di NVS. Tidak blocking,
+    // connect pertama dijalankan task.
+    void begin(const char *deviceName = "EoRa-S3-BLE", bool persistGattCache = true);
+    // Connect langsung ke targetAddress; jika gagal, scan yang berhenti
+    // di advertisement pertama dari target lalu connect lagi. Blocking,
+    // hanya dipanggil dari task connect.
     bool connect();
+    // Bangunkan task connect (tidak blocking). true jika notify sudah aktif.
     bool tryReconnect();
+    BLEReconnectStats reconnectStats() const;
     bool isConnected() const { return (deviceConnected && pClient && pClient->isConnected()); }
+    // Terhubung dan notify sudah aktif
+    bool isReady() const { return ready && isConnected(); }
 
-    bool enableNotify(BLERemoteService *service, BLERemoteCharacteristic *characteristic, void(*callback)(BLERemoteCharacteristic*, uint8_t*, size_t, bool));
+    // Tulis CCCD (dengan respons) lalu daftarkan notify di stack. Dipakai
+    // juga sebagai validasi handle dari cache.
+    bool enableNotify(uint16_t charHandle, uint16_t cccdHandle);
 
-    // Sensor trigger commands
-    bool triggerSpO2();
-    bool triggerStress();
-    BLEData getLastSpO2();
-    BLEData getLastStress();
-    BLEData getLastHR();
+    // Sensor trigger commands, hanya masuk antrian (tidak blocking)
+    bool triggerSpO2() { return queueCommand(BLECommand::SPO2); }
+    bool triggerStress() { return queueCommand(BLECommand::STRESS); }
+    // Perintah yang sama dan masih pending tidak diantrikan dua kali
+    bool queueCommand(BLECommand cmd);
+    // Dari main loop: kirim perintah berikutnya, cek respons dan timeout
+    void loop(uint32_t now);
+    BLECommandStats commandStats() const;
+    // Ambil sampel dari ring buffer (consumer: main loop)
+    bool popSample(BLESample &sample);
+    size_t drainSamples(BLESample *out, size_t max);
+    uint32_t droppedSamples() const { return samples.dropped(); }
+    AolonDecoderStats frameStats() const { return decoder.stats(); }
+    // Service discovery penuh, isi handle GATT
     bool setupServicesAndCharacteristics();
     bool checkServicesAndCharacteristics();
+    // Buang handle cache (RAM dan NVS), connect berikutnya discovery ulang
+    void invalidateGattCache();
 
     // Generic write function
     bool writeBytes(const BLEUUID &serviceUUID, const BLEUUID &charUUID, const uint8_t *data, size_t len);
 
-    static DeviceData BLEDataToSensorData(uint8_t device_id, Topic topic, BLEData data);
+    static DeviceData sampleToDeviceData(uint8_t device_id, const BLESample &sample);
+    DeviceData sampleToDeviceData(const BLESample &sample) const { return sampleToDeviceData(wearerId, sample); }
+    uint8_t deviceId() const { return wearerId; }
 
 private:
-    const char *targetAddress;
-    static BLEManager *instance;
+    BLEAddress target;
+    esp_ble_addr_type_t targetType;
+    uint8_t wearerId;
+    // Semua BLEManager yang sudah begin(). Custom handler GATTC hanya satu
+    // untuk seluruh stack, event diteruskan ke pemilik gattc_if.
+    static BLEManager *managers[BLE_MAX_WEARERS];
+    static size_t managerCount;
     uint32_t scanTime;
-    bool deviceConnected;
-    unsigned long lastReconnectAttempt;
-    static constexpr unsigned long reconnectInterval = 5000;
-    BLEData HR, SpO2, Stress;
+    volatile bool deviceConnected;
+    volatile bool ready; // setupNotify selesai setelah connect
+    // Jadwal reconnect, hanya dipakai task connect
+    uint32_t nextReconnectAt;
+    uint32_t reconnectBackoff;
+    static TaskHandle_t reconnectHandle;
+    static void reconnectTask(void *param);
+    bool reconnectIfDue();
+    // Producer: task BLE stack (gattcEvent)
+    RingBuffer<BLESample, BLE_SAMPLE_QUEUE_LEN> samples;
+    void pushSample(Topic topic, uint8_t value);
 
     BLEClient *pClient;
-    // Remote services for heart rate and generic
-    BLERemoteService *pHRRemoteService;
-    BLERemoteService *pGenericService;
+    // Handle GATT band. Tetap disimpan setelah disconnect sebagai cache RAM;
+    // notify diterima lewat gattcEvent berdasarkan handle.
+    GattHandles handles;
+    bool persistCache;
+    volatile bool cacheStale; // Service Changed dari band
+    SemaphoreHandle_t gattDone;
+    volatile esp_gatt_status_t gattStatus;
 
-    
-    // Remote characteristics for heart rate and generic
-    BLERemoteCharacteristic *pHRNotifyCharacteristic;
-    BLERemoteCharacteristic *pGenericWriteCharacteristic;
-    BLERemoteCharacteristic *pGenericNotifyCharacteristic;
+    // Statistik reconnect
+    uint32_t disconnectTick;
+    uint32_t connectAttempts, connectDirect, connectScanned, connectFailed;
+    uint32_t connectCached, connectDiscoveries;
+    uint32_t connectLastMs, connectMaxMs, connectGapMs;
+    uint64_t connectTotalMs;
+
+    bool scanTarget();
+    // Notify dari handle cache; jika ditolak, discovery lalu simpan cache
+    bool setupNotify();
+    bool writeCommand(const uint8_t *data, size_t len);
+
+    // Scheduler perintah (main loop). Hanya satu perintah in-flight supaya
+    // respons tidak tertukar.
+    RingBuffer<BLECommand, BLE_COMMAND_QUEUE_LEN> commands;
+    BLECommand inflight;
+    bool inflightActive;
+    uint8_t inflightTries;
+    uint32_t inflightFirstTick, inflightSentTick;
+    // Ditulis task BLE stack saat respons cocok dengan inflight
+    volatile int8_t awaiting; // -1 = tidak menunggu
+    volatile uint32_t responseTick;
+    volatile bool responded;
+    BLECommandStats cmdStats;
+    uint64_t cmdTotalMs;
+    bool sendInflight(uint32_t now);
+    void commandResponse(BLECommand cmd);
+
+    class TargetScanCallback : public BLEAdvertisedDeviceCallbacks
+    {
+    public:
+        explicit TargetScanCallback(BLEManager *parent) : parent_(parent) {}
+        void onResult(BLEAdvertisedDevice dev) override;
+        bool found = false;
+
+    private:
+        BLEManager *parent_;
+    } scanCb;
 
-    BLEAddress scanTarget();
+    // Custom handler GATTC (task BLE stack): cari BLEManager pemilik
+    // gattc_if, lalu routing notify per handle, respons write CCCD dan
+    // Service Changed
+    static void gattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param);
+    void onGenericNotify(const uint8_t *data, size_t len);
 
-    static void notifyThunk(BLERemoteCharacteristic *ch, uint8_t *data, size_t len, bool isNotify);
-    static void HRNotifyCallback(BLERemoteCharacteristic *ch, uint8_t *data, size_t len, bool isNotify);
+    // Notify FEE3 -> frame FE EA -> handler per cmd (task BLE stack)
+    static const AolonCommand FRAME_HANDLERS[];
+    AolonDecoder decoder;
+    static bool onSpO2Frame(void *ctx, const AolonFrame &frame);
+    static bool onStressFrame(void *ctx, const AolonFrame &frame);
+    static bool onUnknownFrame(void *ctx, const AolonFrame &frame);
+    void onHRNotify(const uint8_t *data, size_t len);
 
     class MyClientCallback : public BLEClientCallbacks
     {
@@ -0,0 +1,53 @@
+#include "gatt_cache.h"
+#include <Preferences.h>
+
+static const char *GATT_NAMESPACE = "ble_gatt";
+
+void GattCache::key(const uint8_t addr[6], char out[13])
+{
+    for (uint8_t i = 0; i < 6; i++)
+        sprintf(out + i * 2, "%02x", addr[i]);
+}
+
+bool GattCache::load(const uint8_t addr[6], GattHandles &out)
+{
+    char k[13];
+    key(addr, k);
+    Preferences prefs;
+    if (!prefs.begin(GATT_NAMESPACE, true))
+        return false;
+    Record rec;
+    size_t n = prefs.getBytes(k, &rec, sizeof(rec));
+    prefs.end();
+    if (n != sizeof(rec) || rec.version != VERSION || !rec.handles.valid())
+        return false;
+    out = rec.handles;
+    return true;
+}
+
+bool GattCache::store(const uint8_t addr[6], const GattHandles &handles)
+{
+    char k[13];
+    key(addr, k);
+    Preferences prefs;
+    if (!prefs.begin(GATT_NAMESPACE, false))
+        return false;
+    Record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.version = VERSION;
+    rec.handles = handles;
+    bool ok = prefs.putBytes(k, &rec, sizeof(rec)) == sizeof(rec);
+    prefs.end();
+    return ok;
+}
+
+void GattCache::erase(const uint8_t addr[6])
+{
+    char k[13];
+    key(addr, k);
+    Preferences prefs;
+    if (!prefs.begin(GATT_NAMESPACE, false))
+        return;
+    prefs.remove(k);
+    prefs.end();
+}
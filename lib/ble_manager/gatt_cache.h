@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+// Handle GATT band yang dipakai: cukup untuk notify dan write tanpa
+// service discovery
+struct GattHandles
+{
+    uint16_t hrNotify;
+    uint16_t hrCccd;
+    uint16_t write;
+    uint16_t notify;
+    uint16_t notifyCccd;
+
+    bool valid() const { return hrNotify && hrCccd && write && notify && notifyCccd; }
+};
+
+// Simpan handle per alamat peripheral di NVS (namespace "ble_gatt", key =
+// alamat dalam hex) supaya connect pertama setelah boot juga tanpa discovery
+class GattCache
+{
+public:
+    static bool load(const uint8_t addr[6], GattHandles &out);
+    static bool store(const uint8_t addr[6], const GattHandles &handles);
+    static void erase(const uint8_t addr[6]);
+
+private:
+    // Naikkan jika layout GattHandles berubah
+    static constexpr uint8_t VERSION = 1;
+
+    struct Record
+    {
+        uint8_t version;
+        GattHandles handles;
+    };
+
+    static void key(const uint8_t addr[6], char out[13]);
+};
@@ -0,0 +1,124 @@
+#ifdef DEVICE_MODE_BASE
+#include "device_table.h"
+
+DeviceTable::DeviceTable() : used(0)
+{
+    memset(entries, 0, sizeof(entries));
+    memset(slots, DEVICE_SLOT_NONE, sizeof(slots));
+}
+
+DeviceEntry *DeviceTable::lookup(uint8_t device_id, uint32_t now)
+{
+    uint8_t slot = slots[device_id];
+    if (slot != DEVICE_SLOT_NONE)
+        return &entries[slot];
+
+    if (used < DEVICE_TABLE_CAPACITY)
+    {
+        slot = used++;
+    }
+    else
+    {
+        // Penuh: ganti device yang paling lama tidak terdengar
+        slot = 0;
+        for (size_t i = 1; i < used; i++)
+        {
+            if (now - entries[i].lastSeen > now - entries[slot].lastSeen)
+                slot = i;
+        }
+        Serial.printf("[Devices] Table full, evicting device %u\n", entries[slot].device_id);
+        slots[entries[slot].device_id] = DEVICE_SLOT_NONE;
+    }
+
+    DeviceEntry &e = entries[slot];
+    memset(&e, 0, sizeof(e));
+    e.device_id = device_id;
+    e.lastSeen = now;
+    slots[device_id] = slot;
+    return &e;
+}
+
+void DeviceTable::onFrame(uint8_t device_id, uint8_t seq, int rssi, float snr, uint8_t sf,
+                          bool duplicate, int32_t gapDelta, uint32_t now)
+{
+    DeviceEntry *e = lookup(device_id, now);
+    if (e->packets == 0 && e->duplicates == 0)
+    {
+        e->rssi = rssi;
+        e->snr = snr;
+    }
+    else
+    {
+        e->rssi += (rssi - e->rssi) / (1 << DEVICE_EWMA_SHIFT);
+        e->snr += (snr - e->snr) / (1 << DEVICE_EWMA_SHIFT);
+    }
+    e->lastSeen = now;
+    e->sf = sf;
+
+    if (duplicate)
+    {
+        e->duplicates++;
+        return;
+    }
+    e->packets++;
+    e->lastSeq = seq;
+    if (gapDelta > 0)
+        e->gaps += gapDelta;
+    else if (gapDelta < 0 && e->gaps)
+        e->gaps--;
+}
+
+void DeviceTable::onReading(const DeviceData &data, uint32_t now)
+{
+    DeviceEntry *e = lookup(data.device_id, now);
+    // Pemakai di belakang gateway tidak punya frame sendiri, jadi umur
+    // entry dihitung dari pembacaan supaya tidak tergusur saat tabel penuh
+    e->lastSeen = now;
+    switch (data.topic)
+    {
+    case Topic::HEART_RATE:
+        e->heartRate = data.sensor.value;
+        break;
+    case Topic::SPO2:
+        e->spo2 = data.sensor.value;
+        break;
+    case Topic::STRESS:
+        e->stress = data.sensor.value;
+        break;
+    case Topic::HEART_RATE_SUMMARY:
+        e->summary = data.sensor.summary;
+        e->heartRate = data.sensor.summary.last;
+        break;
+    case Topic::SOS:
+        e->lastSos = now ? now : 1;
+        e->location = data.sensor.location;
+        break;
+    case Topic::GPS:
+        e->location = data.sensor.location;
+        break;
+    default:
+        break;
+    }
+}
+
+const DeviceEntry *DeviceTable::find(uint8_t device_id) const
+{
+    uint8_t slot = slots[device_id];
+    return slot == DEVICE_SLOT_NONE ? nullptr : &entries[slot];
+}
+
+void DeviceTable::dump(Print &out, uint32_t now) const
+{
+    out.printf("[Devices] %u/%u\n", (unsigned)used, (unsigned)DEVICE_TABLE_CAPACITY);
+    out.println(F(" id  age_s  pkts  gaps  dup   rssi   snr  sf mgn  hr spo2 str  lat,lon"));
+    for (size_t i = 0; i < used; i++)
+    {
+        const DeviceEntry &e = entries[i];
+        uint32_t loss = (e.packets + e.gaps) ? e.gaps * 100 / (e.packets + e.gaps) : 0;
+        out.printf("%3u %6lu %5lu %5lu %4lu %6.1f %5.1f %3u %3d %3u %4u %3u  %.5f,%.5f%s  loss:%lu%%\n",
+                   e.device_id, (now - e.lastSeen) / 1000, e.packets, e.gaps, e.duplicates,
+                   e.rssi, e.snr, e.sf, linkMargin(e.snr, e.sf), e.heartRate, e.spo2, e.stress,
+                   e.location.lattitude, e.location.longitude, e.lastSos ? " SOS" : "", loss);
+    }
+}
+#endif
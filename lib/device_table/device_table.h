@@ -0,0 +1,63 @@
+#pragma once
+#ifdef DEVICE_MODE_BASE
+#include <Arduino.h>
+#include <data.h>
+#include <adr.h>
+
+static constexpr size_t DEVICE_TABLE_CAPACITY = 64;
+static constexpr uint8_t DEVICE_SLOT_NONE = 0xFF;
+// EWMA RSSI/SNR: avg += (x - avg) / 2^shift
+static constexpr uint8_t DEVICE_EWMA_SHIFT = 3;
+
+// Status satu wearable. Field yang disentuh tiap frame dikelompokkan di
+// depan supaya jalur RX cukup membaca satu-dua cache line.
+struct DeviceEntry
+{
+    // Link, diperbarui tiap frame
+    uint32_t lastSeen; // frame atau pembacaan terakhir (pemakai di gateway)
+    uint32_t packets;
+    uint32_t duplicates;
+    uint32_t gaps;
+    float rssi; // EWMA
+    float snr;  // EWMA
+    uint8_t device_id;
+    uint8_t lastSeq;
+    uint8_t sf;  // SF frame terakhir (ADR)
+
+    // Nilai terakhir per topic
+    uint8_t heartRate;
+    uint8_t spo2;
+    uint8_t stress;
+    HRSummary summary;
+    Location location;
+    uint32_t lastSos; // millis() SOS terakhir, 0 jika belum pernah
+};
+
+// Tabel device di base, kapasitas tetap. device_id -> slot lewat array
+// index 256 byte, jadi lookup O(1) tanpa hashing. Jika penuh, device
+// yang paling lama tidak terdengar diganti.
+class DeviceTable
+{
+public:
+    DeviceTable();
+
+    // Dari jalur RX untuk setiap frame valid (termasuk duplikat).
+    // gapDelta bisa negatif jika frame terlambat menutup gap sebelumnya.
+    void onFrame(uint8_t device_id, uint8_t seq, int rssi, float snr, uint8_t sf,
+                 bool duplicate, int32_t gapDelta, uint32_t now);
+    // Dari main loop untuk setiap pembacaan yang sudah di-resolve
+    void onReading(const DeviceData &data, uint32_t now);
+
+    const DeviceEntry *find(uint8_t device_id) const;
+    size_t count() const { return used; }
+    // Satu baris per device, diurutkan menurut slot
+    void dump(Print &out, uint32_t now) const;
+
+private:
+    DeviceEntry entries[DEVICE_TABLE_CAPACITY];
+    uint8_t slots[256];
+    size_t used;
+
+    DeviceEntry *lookup(uint8_t device_id, uint32_t now);
+};
+#endif
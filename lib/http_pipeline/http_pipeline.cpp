@@ -0,0 +1,202 @@
+#ifdef DEVICE_MODE_BASE
+#include "http_pipeline.h"
+#include <payload_writer.h>
+
+static constexpr uint32_t HTTP_CONNECT_TIMEOUT_MS = 3000;
+static constexpr uint32_t HTTP_CONNECT_BACKOFF_MIN_MS = 1000;
+static constexpr uint32_t HTTP_CONNECT_BACKOFF_MAX_MS = 30000;
+
+HttpPipeline::HttpPipeline(const char *host, uint16_t port, size_t depth, uint32_t timeoutMs)
+    : host(host),
+      port(port),
+      depth(depth == 0 ? 1 : (depth > HTTP_PIPELINE_MAX ? HTTP_PIPELINE_MAX : depth)),
+      timeoutMs(timeoutMs),
+      head(0),
+      count(0),
+      completed(0),
+      lastMs(0),
+      minMs(UINT32_MAX),
+      maxMs(0),
+      connects(0),
+      errors(0),
+      totalMs(0),
+      connState(ConnState::IDLE),
+      connectHandle(nullptr),
+      connectRetryAt(0),
+      connectBackoff(HTTP_CONNECT_BACKOFF_MIN_MS) {}
+
+void HttpPipeline::connectTask(void *param)
+{
+    HttpPipeline *self = (HttpPipeline *)param;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool ok = self->client.connect(self->host, self->port, HTTP_CONNECT_TIMEOUT_MS);
+        self->connState = ok ? ConnState::OPENED : ConnState::FAILED;
+    }
+}
+
+bool HttpPipeline::startConnect()
+{
+    // Task dibuat saat pertama dipakai, scheduler belum jalan di konstruktor global
+    if (!connectHandle &&
+        xTaskCreatePinnedToCore(connectTask, "HTTP connect", 4096, this, 1, &connectHandle, 0) != pdPASS)
+    {
+        connectHandle = nullptr;
+        return false;
+    }
+    client.stop();
+    parser.reset();
+    connState = ConnState::CONNECTING;
+    xTaskNotifyGive(connectHandle);
+    return true;
+}
+
+bool HttpPipeline::canSend() const
+{
+    if (count >= depth)
+        return false;
+    ConnState state = connState;
+    if (state == ConnState::CONNECTING)
+        return false;
+    if (state == ConnState::BACKOFF)
+        return (int32_t)(millis() - connectRetryAt) >= 0;
+    // FAILED tetap boleh: post() berikutnya melaporkan kegagalan lalu mulai backoff
+    return true;
+}
+
+bool HttpPipeline::write(const char *path, const char *contentType, const uint8_t *body, size_t len)
+{
+    char header[256];
+    BufferWriter w(header, sizeof(header));
+    w.str("POST ").str(path).str(" HTTP/1.1\r\nHost: ").str(host);
+    w.str("\r\nConnection: keep-alive\r\nContent-Type: ").str(contentType);
+    w.str("\r\nContent-Length: ").u32(len).str("\r\n\r\n");
+    if (w.overflow())
+        return false;
+    return client.write((const uint8_t *)header, w.length()) == w.length() &&
+           client.write(body, len) == len;
+}
+
+bool HttpPipeline::post(const char *path, const char *contentType, const uint8_t *body, size_t len)
+{
+    if (!canSend())
+        return false;
+
+    ConnState state = connState;
+    if (state == ConnState::FAILED)
+    {
+        Serial.printf("[HTTP] Connect to %s:%u failed, retry in %lu ms\n", host, port, connectBackoff);
+        connState = ConnState::BACKOFF;
+        connectRetryAt = millis() + connectBackoff;
+        connectBackoff = min(connectBackoff * 2, HTTP_CONNECT_BACKOFF_MAX_MS);
+        return false;
+    }
+    if (state == ConnState::OPENED)
+    {
+        client.setNoDelay(true);
+        connects++;
+        connectBackoff = HTTP_CONNECT_BACKOFF_MIN_MS;
+        connState = ConnState::CONNECTED;
+    }
+
+    if (connState != ConnState::CONNECTED || !client.connected())
+    {
+        // Request tertunda di koneksi lama dilaporkan gagal oleh poll() dulu
+        if (!count)
+            startConnect();
+        return false;
+    }
+    if (!write(path, contentType, body, len))
+    {
+        // Koneksi idle mungkin sudah ditutup server, buka lagi di task
+        client.stop();
+        connState = ConnState::IDLE;
+        if (!count)
+            startConnect();
+        return false;
+    }
+    sentAt[(head + count) % HTTP_PIPELINE_MAX] = millis();
+    count++;
+    return true;
+}
+
+bool HttpPipeline::poll(HttpResult &result)
+{
+    if (!count)
+        return false;
+
+    // millis() langsung, bukan waktu awal loop(), supaya latency akurat
+    uint32_t now = millis();
+    while (client.available())
+    {
+        int c = client.read();
+        if (c < 0)
+            break;
+        if (!parser.feed((char)c))
+        {
+            if (parser.failed())
+                return fail(result, now);
+            continue;
+        }
+
+        result.status = parser.status();
+        result.latencyMs = now - sentAt[head];
+        head = (head + 1) % HTTP_PIPELINE_MAX;
+        count--;
+
+        completed++;
+        totalMs += result.latencyMs;
+        lastMs = result.latencyMs;
+        if (result.latencyMs < minMs)
+            minMs = result.latencyMs;
+        if (result.latencyMs > maxMs)
+            maxMs = result.latencyMs;
+
+        // Sisa request tertunda akan gagal di poll() berikutnya
+        if (parser.closeAfter())
+            client.stop();
+        return true;
+    }
+
+    if (!client.connected() || now - sentAt[head] >= timeoutMs)
+        return fail(result, now);
+    return false;
+}
+
+bool HttpPipeline::fail(HttpResult &result, uint32_t now)
+{
+    Serial.printf("[HTTP] Connection lost with %u requests pending\n", (unsigned)count);
+    result.status = -1;
+    result.latencyMs = now - sentAt[head];
+    errors++;
+    reset();
+    return true;
+}
+
+void HttpPipeline::reset()
+{
+    // client sedang dipakai task connect, hasilnya dipakai post() nanti
+    ConnState state = connState;
+    if (state != ConnState::CONNECTING)
+        client.stop();
+    if (state == ConnState::OPENED || state == ConnState::CONNECTED)
+        connState = ConnState::IDLE;
+    parser.reset();
+    head = 0;
+    count = 0;
+}
+
+HttpLatencyStats HttpPipeline::stats() const
+{
+    HttpLatencyStats s;
+    s.completed = completed;
+    s.lastMs = lastMs;
+    s.minMs = completed ? minMs : 0;
+    s.maxMs = maxMs;
+    s.avgMs = completed ? (uint32_t)(totalMs / completed) : 0;
+    s.connects = connects;
+    s.errors = errors;
+    return s;
+}
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#ifdef DEVICE_MODE_BASE
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include "http_response_parser.h"
+
+static constexpr size_t HTTP_PIPELINE_MAX = 8;
+
+struct HttpResult
+{
+    int status;         // kode HTTP, -1 jika koneksi putus/timeout
+    uint32_t latencyMs; // dari request ditulis sampai response lengkap
+};
+
+struct HttpLatencyStats
+{
+    uint32_t completed;
+    uint32_t lastMs;
+    uint32_t minMs;
+    uint32_t maxMs;
+    uint32_t avgMs;
+    uint32_t connects; // koneksi TCP yang dibuka (1 jika keep-alive bertahan)
+    uint32_t errors;   // koneksi putus/timeout dengan request tertunda
+};
+
+// Klien HTTP/1.1 ke satu host dengan satu koneksi keep-alive. Beberapa
+// POST bisa ditulis tanpa menunggu response (pipelining, maksimal depth);
+// response datang berurutan dan diambil lewat poll() dari loop().
+//
+// Jika koneksi putus, timeout, atau server mengirim "Connection: close"
+// saat masih ada request tertunda, poll() mengembalikan satu hasil -1 dan
+// semua request tertunda dibuang. POST berikutnya membuka koneksi baru.
+//
+// Koneksi (DNS + TCP connect, bisa beberapa detik) dibuka oleh task
+// sendiri supaya loop() tidak tertahan: post() tanpa koneksi hanya
+// memulai connect lalu return false dengan connecting() true. Selama
+// connect berjalan dan selama jeda backoff setelah connect gagal
+// (HTTP_CONNECT_BACKOFF_MIN_MS, dobel tiap gagal), canSend() false.
+class HttpPipeline
+{
+public:
+    HttpPipeline(const char *host, uint16_t port = 80, size_t depth = 4, uint32_t timeoutMs = 10000);
+
+    bool canSend() const;
+    size_t inFlight() const { return count; }
+    bool connecting() const { return connState == ConnState::CONNECTING; }
+    bool post(const char *path, const char *contentType, const uint8_t *body, size_t len);
+    // Return true jika ada response (atau kegagalan) yang selesai
+    bool poll(HttpResult &result);
+    // Tutup koneksi dan buang semua request tertunda
+    void reset();
+    HttpLatencyStats stats() const;
+
+private:
+    enum class ConnState : uint8_t
+    {
+        IDLE,
+        CONNECTING, // client dipakai task connect, loop() tidak menyentuhnya
+        OPENED,     // connect berhasil, belum dipakai post()
+        CONNECTED,
+        FAILED,     // connect gagal, belum dilaporkan post()
+        BACKOFF     // menunggu connectRetryAt sebelum connect lagi
+    };
+
+    WiFiClient client;
+    HttpResponseParser parser;
+    const char *host;
+    uint16_t port;
+    size_t depth;
+    uint32_t timeoutMs;
+
+    // FIFO waktu kirim request tertunda
+    uint32_t sentAt[HTTP_PIPELINE_MAX];
+    size_t head;
+    size_t count;
+
+    uint32_t completed, lastMs, minMs, maxMs, connects, errors;
+    uint64_t totalMs;
+
+    std::atomic<ConnState> connState;
+    TaskHandle_t connectHandle;
+    uint32_t connectRetryAt;
+    uint32_t connectBackoff;
+
+    static void connectTask(void *param);
+    bool startConnect();
+    bool write(const char *path, const char *contentType, const uint8_t *body, size_t len);
+    bool fail(HttpResult &result, uint32_t now);
+};
+#endif
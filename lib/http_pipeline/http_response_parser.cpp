@@ -0,0 +1,106 @@
+#include "http_response_parser.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+void HttpResponseParser::reset()
+{
+    state = State::STATUS;
+    lineLen = 0;
+    code = 0;
+    remaining = 0;
+    chunked = false;
+    close = false;
+}
+
+bool HttpResponseParser::feed(char c)
+{
+    switch (state)
+    {
+    case State::BODY:
+        if (--remaining == 0)
+            return finish();
+        return false;
+    case State::CHUNK_DATA:
+        if (--remaining == 0)
+            state = State::CHUNK_END;
+        return false;
+    case State::ERROR:
+        return false;
+    default:
+        break;
+    }
+
+    // State berbasis baris; header disimpan lowercase, baris yang terlalu
+    // panjang dipotong (tidak ada header penting yang sepanjang itu)
+    if (c == '\r')
+        return false;
+    if (c != '\n')
+    {
+        if (lineLen < sizeof(line) - 1)
+            line[lineLen++] = tolower((unsigned char)c);
+        return false;
+    }
+    line[lineLen] = '\0';
+    bool done = endOfLine();
+    lineLen = 0;
+    return done;
+}
+
+bool HttpResponseParser::endOfLine()
+{
+    switch (state)
+    {
+    case State::STATUS:
+        // "http/1.1 200 OK"
+        if (strncmp(line, "http/1.", 7) != 0 || lineLen < 12)
+        {
+            state = State::ERROR;
+            return false;
+        }
+        code = atoi(line + 9);
+        close = line[7] == '0';
+        chunked = false;
+        remaining = 0;
+        state = State::HEADER;
+        return false;
+    case State::HEADER:
+        if (lineLen == 0)
+        {
+            if (chunked)
+                state = State::CHUNK_SIZE;
+            else if (remaining)
+                state = State::BODY;
+            else
+                return finish();
+            return false;
+        }
+        if (strncmp(line, "content-length:", 15) == 0)
+            remaining = strtoul(line + 15, nullptr, 10);
+        else if (strncmp(line, "transfer-encoding:", 18) == 0)
+            chunked = strstr(line + 18, "chunked") != nullptr;
+        else if (strncmp(line, "connection:", 11) == 0)
+            close = strstr(line + 11, "close") != nullptr;
+        return false;
+    case State::CHUNK_SIZE:
+        remaining = strtoul(line, nullptr, 16);
+        state = remaining ? State::CHUNK_DATA : State::TRAILER;
+        return false;
+    case State::CHUNK_END:
+        state = State::CHUNK_SIZE;
+        return false;
+    case State::TRAILER:
+        if (lineLen == 0)
+            return finish();
+        return false;
+    default:
+        return false;
+    }
+}
+
+bool HttpResponseParser::finish()
+{
+    // status dan close tetap terbaca sampai status line berikutnya
+    state = State::STATUS;
+    return true;
+}
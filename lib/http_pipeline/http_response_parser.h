@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Parser response HTTP/1.1 streaming, satu byte per feed(). Body tidak
+// disimpan, hanya status dan info yang dibutuhkan untuk keep-alive
+// (Content-Length, chunked, Connection: close).
+class HttpResponseParser
+{
+public:
+    HttpResponseParser() { reset(); }
+
+    void reset();
+    // Return true saat satu response lengkap. Byte berikutnya milik
+    // response selanjutnya (pipelining).
+    bool feed(char c);
+
+    int status() const { return code; }
+    bool closeAfter() const { return close; }
+    bool failed() const { return state == State::ERROR; }
+
+private:
+    enum class State : uint8_t
+    {
+        STATUS,
+        HEADER,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_END,
+        TRAILER,
+        ERROR
+    };
+
+    State state;
+    char line[64];
+    uint8_t lineLen;
+    int code;
+    uint32_t remaining;
+    bool chunked;
+    bool close;
+
+    bool endOfLine();
+    bool finish();
+};
@@ -0,0 +1,360 @@
+#include "journal.h"
+#include <string.h>
+#include <unistd.h>
+#include <lora_packet.h>
+
+static constexpr uint8_t HEADER_MAGIC = 0x5A;
+static constexpr uint8_t RECORD_MAGIC = 0xA5;
+static constexpr size_t RECORD_PAYLOAD_OFFSET = 10;
+static constexpr size_t RECORD_PAYLOAD_LEN = 8;
+
+static void putU32(uint8_t *p, uint32_t v)
+{
+    for (uint8_t i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ===========================================
+// FileJournalStorage
+// ===========================================
+FileJournalStorage::FileJournalStorage(const char *path, uint32_t size, uint32_t eraseSize)
+    : path(path), bytes(size), sector(eraseSize), file(nullptr) {}
+
+FileJournalStorage::~FileJournalStorage()
+{
+    if (file)
+        fclose(file);
+}
+
+bool FileJournalStorage::fill(uint32_t offset, size_t len)
+{
+    uint8_t ff[64];
+    memset(ff, 0xFF, sizeof(ff));
+    if (fseek(file, offset, SEEK_SET) != 0)
+        return false;
+    while (len)
+    {
+        size_t chunk = len < sizeof(ff) ? len : sizeof(ff);
+        if (fwrite(ff, 1, chunk, file) != chunk)
+            return false;
+        len -= chunk;
+    }
+    return true;
+}
+
+bool FileJournalStorage::open()
+{
+    file = fopen(path, "r+b");
+    if (!file)
+        file = fopen(path, "w+b");
+    if (!file)
+        return false;
+
+    // Pastikan file sudah sepanjang size, sisanya dianggap ter-erase
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    if (len < 0)
+        return false;
+    if ((uint32_t)len < bytes)
+    {
+        if (!fill((uint32_t)len, bytes - (uint32_t)len))
+            return false;
+        fflush(file);
+    }
+    return true;
+}
+
+bool FileJournalStorage::read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (!file || offset + len > bytes || fseek(file, offset, SEEK_SET) != 0)
+        return false;
+    return fread(buf, 1, len, file) == len;
+}
+
+bool FileJournalStorage::write(uint32_t offset, const uint8_t *buf, size_t len)
+{
+    if (!file || offset + len > bytes || fseek(file, offset, SEEK_SET) != 0)
+        return false;
+    return fwrite(buf, 1, len, file) == len;
+}
+
+bool FileJournalStorage::erase(uint32_t offset, size_t len)
+{
+    if (!file || offset + len > bytes || offset % sector || len % sector)
+        return false;
+    return fill(offset, len);
+}
+
+bool FileJournalStorage::sync()
+{
+    // fflush hanya memindah buffer stdio ke VFS, fsync yang menulis ke media
+    return file && fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+#ifdef DEVICE_MODE_BASE
+// ===========================================
+// PartitionJournalStorage
+// ===========================================
+PartitionJournalStorage::PartitionJournalStorage(const char *label)
+    : label(label), partition(nullptr) {}
+
+bool PartitionJournalStorage::open()
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    return partition != nullptr;
+}
+
+bool PartitionJournalStorage::read(uint32_t offset, uint8_t *buf, size_t len)
+{
+    return partition && esp_partition_read(partition, offset, buf, len) == ESP_OK;
+}
+
+bool PartitionJournalStorage::write(uint32_t offset, const uint8_t *buf, size_t len)
+{
+    return partition && esp_partition_write(partition, offset, buf, len) == ESP_OK;
+}
+
+bool PartitionJournalStorage::erase(uint32_t offset, size_t len)
+{
+    return partition && esp_partition_erase_range(partition, offset, len) == ESP_OK;
+}
+#endif
+
+// ===========================================
+// Journal
+// ===========================================
+Journal::Journal(JournalStorage &storage)
+    : storage(storage),
+      sector(0),
+      perSector(0),
+      slots(0),
+      tailSeq(1),
+      nextSeq(1),
+      headerSector(0),
+      headerPos(0),
+      overwrittenCount(0),
+      dirty(false) {}
+
+uint32_t Journal::slotOffset(uint32_t seq) const
+{
+    uint32_t slot = seq % slots;
+    return (HEADER_SECTORS + slot / perSector) * sector + (slot % perSector) * RECORD_LEN;
+}
+
+bool Journal::blank(uint32_t offset, size_t len)
+{
+    uint8_t buf[RECORD_LEN];
+    if (len > sizeof(buf) || !storage.read(offset, buf, len))
+        return false;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (buf[i] != 0xFF)
+            return false;
+    }
+    return true;
+}
+
+bool Journal::readHeader(uint32_t offset, uint32_t &consumed)
+{
+    uint8_t buf[HEADER_LEN];
+    if (!storage.read(offset, buf, sizeof(buf)))
+        return false;
+    if (buf[0] != HEADER_MAGIC || crc8(buf, HEADER_LEN - 1) != buf[HEADER_LEN - 1])
+        return false;
+    consumed = getU32(&buf[1]);
+    return true;
+}
+
+bool Journal::writeHeader(uint32_t consumed)
+{
+    uint8_t buf[HEADER_LEN] = {0};
+    buf[0] = HEADER_MAGIC;
+    putU32(&buf[1], consumed);
+    buf[HEADER_LEN - 1] = crc8(buf, HEADER_LEN - 1);
+
+    // Entry kosong berikutnya; entry yang terpotong saat crash dilewati
+    uint32_t entries = sector / HEADER_LEN;
+    while (headerPos < entries && !blank(headerSector * sector + headerPos * HEADER_LEN, HEADER_LEN))
+        headerPos++;
+    if (headerPos >= entries)
+    {
+        // Log penuh: pindah ke sektor lain, entry terbaru di sektor lama
+        // tetap berlaku sampai entry baru tertulis
+        headerSector ^= 1;
+        headerPos = 0;
+        if (!storage.erase(headerSector * sector, sector))
+            return false;
+    }
+    dirty = true;
+    return storage.write(headerSector * sector + headerPos++ * HEADER_LEN, buf, sizeof(buf));
+}
+
+bool Journal::readRecord(uint32_t seq, UplinkItem *item)
+{
+    uint8_t buf[RECORD_LEN];
+    if (!storage.read(slotOffset(seq), buf, sizeof(buf)))
+        return false;
+    if (buf[0] != RECORD_MAGIC || crc8(buf, RECORD_LEN - 1) != buf[RECORD_LEN - 1])
+        return false;
+    if (getU32(&buf[1]) != seq)
+        return false;
+    if (!item)
+        return true;
+
+    item->timestamp = getU32(&buf[5]);
+    BitReader r(&buf[RECORD_PAYLOAD_OFFSET], RECORD_PAYLOAD_LEN);
+    return decodeRecord(r, buf[9], item->data);
+}
+
+void Journal::skipInvalidTail()
+{
+    // Record rusak atau slot yang dilewati append di awal antrian
+    while (tailSeq < nextSeq && !readRecord(tailSeq, nullptr))
+        tailSeq++;
+}
+
+bool Journal::begin()
+{
+    sector = storage.eraseSize();
+    if (!sector || sector < RECORD_LEN || sector % HEADER_LEN)
+        return false;
+    uint32_t sectors = storage.size() / sector;
+    // Minimal dua sektor record, supaya erase sektor berikutnya tidak
+    // menghapus semua record pending
+    if (sectors < HEADER_SECTORS + 2)
+        return false;
+    perSector = sector / RECORD_LEN;
+    slots = perSector * (sectors - HEADER_SECTORS);
+
+    // Entry header terbaru = consumed terbesar di kedua sektor log
+    uint32_t consumed = 0, c;
+    bool found = false;
+    for (uint8_t s = 0; s < HEADER_SECTORS; s++)
+    {
+        for (uint32_t pos = 0; pos < sector / HEADER_LEN; pos++)
+        {
+            if (readHeader(s * sector + pos * HEADER_LEN, c) && (!found || c >= consumed))
+            {
+                consumed = c;
+                found = true;
+                headerSector = s;
+                headerPos = pos + 1;
+            }
+        }
+    }
+
+    // Cari seq terbesar yang valid
+    uint32_t maxSeq = consumed;
+    uint8_t buf[RECORD_LEN];
+    for (uint32_t slot = 0; slot < slots; slot++)
+    {
+        uint32_t offset = (HEADER_SECTORS + slot / perSector) * sector + (slot % perSector) * RECORD_LEN;
+        if (!storage.read(offset, buf, sizeof(buf)))
+            return false;
+        if (buf[0] != RECORD_MAGIC || crc8(buf, RECORD_LEN - 1) != buf[RECORD_LEN - 1])
+            continue;
+        uint32_t seq = getU32(&buf[1]);
+        if (seq > maxSeq)
+            maxSeq = seq;
+    }
+
+    nextSeq = maxSeq + 1;
+    tailSeq = consumed + 1;
+    // Record hilang (mis. partisi baru), seq tetap lanjut setelah consumed
+    if (tailSeq > nextSeq)
+        nextSeq = tailSeq;
+    if (nextSeq - tailSeq > slots)
+        tailSeq = nextSeq - slots;
+    skipInvalidTail();
+    return true;
+}
+
+bool Journal::append(const UplinkItem &item, uint32_t *seq)
+{
+    if (!slots)
+        return false;
+
+    // Slot harus ter-erase sebelum ditulis
+    while (true)
+    {
+        uint32_t pos = nextSeq % slots % perSector;
+        uint32_t offset = slotOffset(nextSeq);
+        if (pos == 0 || (empty() && !blank(offset, RECORD_LEN)))
+        {
+            // Masuk sektor berikutnya (atau sektor berisi sisa lama saat
+            // journal kosong): erase, record putaran sebelumnya di sektor
+            // ini hilang
+            if (!storage.erase(offset - pos * RECORD_LEN, sector))
+                return false;
+            uint32_t keep = nextSeq - pos + perSector;
+            if (keep > slots && tailSeq < keep - slots)
+            {
+                overwrittenCount += keep - slots - tailSeq;
+                tailSeq = keep - slots;
+                skipInvalidTail();
+            }
+            break;
+        }
+        if (blank(offset, RECORD_LEN))
+            break;
+        // Sisa tulis yang terpotong (crash): lewati seq ini
+        nextSeq++;
+    }
+
+    uint8_t buf[RECORD_LEN] = {0};
+    buf[0] = RECORD_MAGIC;
+    putU32(&buf[1], nextSeq);
+    putU32(&buf[5], item.timestamp);
+    buf[9] = item.data.device_id;
+    BitWriter w(&buf[RECORD_PAYLOAD_OFFSET], RECORD_PAYLOAD_LEN);
+    if (!encodeRecord(w, item.data))
+        return false;
+    buf[RECORD_LEN - 1] = crc8(buf, RECORD_LEN - 1);
+
+    dirty = true;
+    if (!storage.write(slotOffset(nextSeq), buf, sizeof(buf)))
+        return false;
+    if (seq)
+        *seq = nextSeq;
+    nextSeq++;
+    return true;
+}
+
+bool Journal::read(size_t i, UplinkItem &item)
+{
+    if (i >= pending())
+        return false;
+    return readRecord(tailSeq + i, &item);
+}
+
+bool Journal::consume(size_t n)
+{
+    if (n > pending())
+        n = pending();
+    return consumeThrough(tailSeq + n - 1);
+}
+
+bool Journal::consumeThrough(uint32_t seq)
+{
+    // Sudah terkirim atau sudah tertimpa append
+    if (seq < tailSeq)
+        return true;
+    if (seq >= nextSeq)
+        seq = nextSeq - 1;
+    tailSeq = seq + 1;
+    skipInvalidTail();
+    return writeHeader(tailSeq - 1);
+}
+
+bool Journal::sync()
+{
+    if (!dirty)
+        return true;
+    dirty = false;
+    return storage.sync();
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <data.h>
+#ifdef DEVICE_MODE_BASE
+#include <esp_partition.h>
+#endif
+
+// ===========================================
+// Storage untuk journal
+// ===========================================
+// Abstraksi blok byte dengan ukuran tetap dan semantik flash NOR: write
+// hanya mengubah bit 1 -> 0, jadi area harus di-erase (diisi 0xFF) per
+// blok eraseSize() sebelum ditulis ulang. Di ESP32 dipakai partisi data
+// mentah, di host cukup file biasa.
+class JournalStorage
+{
+public:
+    virtual ~JournalStorage() {}
+    virtual bool read(uint32_t offset, uint8_t *buf, size_t len) = 0;
+    virtual bool write(uint32_t offset, const uint8_t *buf, size_t len) = 0;
+    virtual bool erase(uint32_t offset, size_t len) = 0;
+    virtual bool sync() = 0;
+    virtual uint32_t size() const = 0;
+    virtual uint32_t eraseSize() const = 0;
+};
+
+class FileJournalStorage : public JournalStorage
+{
+public:
+    FileJournalStorage(const char *path, uint32_t size, uint32_t eraseSize = 4096);
+    ~FileJournalStorage();
+    // Buka file, dibuat dan diisi 0xFF (ter-erase) sampai size jika belum ada
+    bool open();
+
+    bool read(uint32_t offset, uint8_t *buf, size_t len) override;
+    bool write(uint32_t offset, const uint8_t *buf, size_t len) override;
+    bool erase(uint32_t offset, size_t len) override;
+    bool sync() override;
+    uint32_t size() const override { return bytes; }
+    uint32_t eraseSize() const override { return sector; }
+
+private:
+    const char *path;
+    uint32_t bytes;
+    uint32_t sector;
+    FILE *file;
+    bool fill(uint32_t offset, size_t len);
+};
+
+#ifdef DEVICE_MODE_BASE
+// Partisi data mentah (lihat partitions_base.csv). Tanpa filesystem,
+// write kecil di tengah ring tidak menyalin ulang blok lain seperti file
+// LittleFS, dan tidak perlu sync.
+class PartitionJournalStorage : public JournalStorage
+{
+public:
+    explicit PartitionJournalStorage(const char *label);
+    bool open();
+
+    bool read(uint32_t offset, uint8_t *buf, size_t len) override;
+    bool write(uint32_t offset, const uint8_t *buf, size_t len) override;
+    bool erase(uint32_t offset, size_t len) override;
+    bool sync() override { return true; }
+    uint32_t size() const override { return partition ? partition->size : 0; }
+    uint32_t eraseSize() const override { return SPI_FLASH_SEC_SIZE; }
+
+private:
+    const char *label;
+    const esp_partition_t *partition;
+};
+#endif
+
+// ===========================================
+// Journal append-only (ring)
+// ===========================================
+// Storage dibagi per sektor erase: dua sektor pertama log header, sisanya
+// ring record. Record ke-seq disimpan di slot seq % slots (record tidak
+// melewati batas sektor), setiap record punya CRC sehingga record yang
+// terpotong saat crash diabaikan ketika begin().
+//
+// Posisi baca (seq terakhir yang sudah terkirim) ditambahkan sebagai entry
+// baru di log header, tidak pernah menimpa entry lama. Jika satu sektor log
+// penuh, sektor lainnya di-erase dan dipakai; entry terbaru di sektor lama
+// tetap utuh sampai entry pertama di sektor baru tertulis.
+//
+// Saat append masuk ke sektor record berikutnya, sektor itu di-erase dulu.
+// Jika penuh, record tertua di sektor itu ikut hilang (satu sektor sekaligus).
+//
+// append()/consume() tidak sync; panggil sync() sekali per flush.
+class Journal
+{
+public:
+    explicit Journal(JournalStorage &storage);
+
+    // Scan storage dan pulihkan posisi baca/tulis
+    bool begin();
+    // seq (opsional) = seq record yang ditulis
+    bool append(const UplinkItem &item, uint32_t *seq = nullptr);
+    // Baca record pending ke-i dari yang tertua. false juga untuk slot yang
+    // dilewati append karena sisa tulis yang terpotong.
+    bool read(size_t i, UplinkItem &item);
+    // Tandai n record tertua sudah terkirim
+    bool consume(size_t n);
+    // Tandai semua record sampai seq (inklusif) sudah terkirim. Dipakai
+    // untuk batch in-flight: jika journal penuh, append menggeser tail
+    // sehingga jumlah record saja tidak lagi menunjuk record yang benar.
+    bool consumeThrough(uint32_t seq);
+    // Tulis ke media semua append/consume sejak sync terakhir
+    bool sync();
+    // Seq absolut record pending tertua (read(i) membaca tail() + i)
+    uint32_t tail() const { return tailSeq; }
+
+    uint32_t pending() const { return nextSeq - tailSeq; }
+    bool empty() const { return pending() == 0; }
+    // Record yang pasti muat tanpa menimpa (satu sektor disisakan untuk erase)
+    uint32_t capacity() const { return slots ? slots - perSector : 0; }
+    uint32_t overwritten() const { return overwrittenCount; }
+
+    static constexpr size_t HEADER_LEN = 8;
+    static constexpr size_t RECORD_LEN = 20;
+    static constexpr uint32_t HEADER_SECTORS = 2;
+
+private:
+    JournalStorage &storage;
+    uint32_t sector;    // eraseSize() storage
+    uint32_t perSector; // record per sektor
+    uint32_t slots;
+    uint32_t tailSeq;   // record pending tertua
+    uint32_t nextSeq;   // seq untuk append berikutnya
+    uint8_t headerSector;
+    uint32_t headerPos; // entry log header berikutnya di headerSector
+    uint32_t overwrittenCount;
+    bool dirty;
+
+    uint32_t slotOffset(uint32_t seq) const;
+    bool blank(uint32_t offset, size_t len);
+    bool readRecord(uint32_t seq, UplinkItem *item);
+    bool writeHeader(uint32_t consumed);
+    bool readHeader(uint32_t offset, uint32_t &consumed);
+    void skipInvalidTail();
+};
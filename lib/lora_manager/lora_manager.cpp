@@ -1,11 +1,18 @@
 #include "lora_manager.h"
 
+LoRaHandler *LoRaHandler::instance = nullptr;
+volatile bool LoRaHandler::dio1Fired = false;
+volatile uint32_t LoRaHandler::dio1Tick = 0;
+
 LoRaHandler::LoRaHandler(int nss, int dio1, int rst, int busy, int sck, int miso, int mosi)
     : _nss(nss), _dio1(dio1), _rst(rst), _busy(busy),
       _sck(sck), _miso(miso), _mosi(mosi),
       spi(FSPI),
       module(_nss, _dio1, _rst, _busy, spi),
-      radio(&module) {}
+      radio(&module)
+{
+    instance = this;
+}
 
 bool LoRaHandler::begin(float frequency)
 {
@@ -19,7 +26,7 @@ bool LoRaHandler::begin(float frequency)
 
     spi.begin(_sck, _miso, _mosi, _nss);
 
-    int state = radio.begin(frequency, 125.0, 7, 5, 0x34, 14, 8, 0.0f, false);
+    int state = radio.begin(frequency, 125.0, LORA_SF_MIN, 5, 0x34, LORA_TX_POWER, 8, 0.0f, false);
     if (state != RADIOLIB_ERR_NONE)
     {
         Serial.print(F("[LoRa] init failed: "));
@@ -27,12 +34,105 @@ bool LoRaHandler::begin(float frequency)
         return false;
     }
 
+    radio.setDio1Action(onDio1);
+    plan.freqs[0] = frequency;
+    plan.count = 1;
+    currentChannel = 0;
+    currentSf = LORA_SF_MIN;
+    currentPower = LORA_TX_POWER;
+
     Serial.print(F("[LoRa] OK freq "));
     Serial.print(frequency);
     Serial.println(F(" MHz"));
     return true;
 }
 
+bool LoRaHandler::setChannelPlan(const ChannelPlan &newPlan)
+{
+    if (newPlan.count == 0 || newPlan.count > CHANNEL_PLAN_MAX)
+        return false;
+    plan = newPlan;
+    memset(chStats, 0, sizeof(chStats));
+    // Base scan butuh preamble lebih panjang dari waktu satu putaran CAD
+    int state = radio.setPreambleLength(plan.preambleLength());
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.printf("[LoRa] setPreambleLength failed: %d\n", state);
+        return false;
+    }
+    currentChannel = 0xFF;
+    tune(0);
+    Serial.printf("[LoRa] Channel plan: %u channels, control %.1f MHz\n", plan.count, plan.freqs[0]);
+    return true;
+}
+
+void LoRaHandler::tune(uint8_t ch)
+{
+    if (ch == currentChannel)
+        return;
+    radio.standby();
+    int state = radio.setFrequency(plan.freqs[ch]);
+    if (state != RADIOLIB_ERR_NONE)
+        Serial.printf("[LoRa] setFrequency %.1f failed: %d\n", plan.freqs[ch], state);
+    currentChannel = ch;
+}
+
+void LoRaHandler::setAdrLimits(const AdrLimits &limits)
+{
+    adr = limits;
+    if (adr.minSf < LORA_SF_MIN)
+        adr.minSf = LORA_SF_MIN;
+    if (adr.maxSf > LORA_SF_MAX)
+        adr.maxSf = LORA_SF_MAX;
+    if (adr.maxSf < adr.minSf)
+        adr.maxSf = adr.minSf;
+#ifdef DEVICE_MODE_BASE
+    slots.setLimits(adr);
+#else
+    txPower = constrain(txPower, adr.minPower, adr.maxPower);
+#endif
+    Serial.printf("[LoRa] ADR: SF%u-%u, %d-%d dBm\n", adr.minSf, adr.maxSf, adr.minPower, adr.maxPower);
+}
+
+void LoRaHandler::setSf(uint8_t sf)
+{
+    if (sf == currentSf)
+        return;
+    radio.standby();
+    int state = radio.setSpreadingFactor(sf);
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.printf("[LoRa] setSpreadingFactor %u failed: %d\n", sf, state);
+        return;
+    }
+    currentSf = sf;
+}
+
+void LoRaHandler::setPower(int8_t dbm)
+{
+    if (dbm == currentPower)
+        return;
+    radio.standby();
+    int state = radio.setOutputPower(dbm);
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.printf("[LoRa] setOutputPower %d failed: %d\n", dbm, state);
+        return;
+    }
+    currentPower = dbm;
+}
+
+LoRaChannelStats LoRaHandler::channelStats(uint8_t ch) const
+{
+    LoRaChannelStats s = {};
+    if (ch < plan.count)
+    {
+        s = chStats[ch];
+        s.freq = plan.freqs[ch];
+    }
+    return s;
+}
+
 void LoRaHandler::sendMessage(const String &message)
 {
     String msg = message; // RadioLib transmit butuh non-const
@@ -75,21 +175,646 @@ void LoRaHandler::transmit(const uint8_t* data, size_t len)
         Serial.println(state);
     }
 }
+
+// ===========================================
+// DIO1 interrupt (TX done / RX done)
+// ===========================================
+void IRAM_ATTR LoRaHandler::onDio1()
+{
+    // SPI tidak boleh dipakai di ISR, cukup tandai atau bangunkan RX task
+    dio1Fired = true;
+    dio1Tick = millis();
 #ifdef DEVICE_MODE_BASE
-bool LoRaHandler::receive()
+    BaseType_t woken = pdFALSE;
+    if (instance && instance->rxTaskHandle)
+        vTaskNotifyGiveFromISR(instance->rxTaskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+#endif
+}
+
+// ===========================================
+// Async transmit queue
+// ===========================================
+bool LoRaHandler::enqueue(const uint8_t *data, size_t len, bool urgent)
 {
-    uint8_t data[RADIOLIB_SX126X_MAX_PACKET_LENGTH];
-    size_t len = RADIOLIB_SX126X_MAX_PACKET_LENGTH;
-    int state = radio.receive((uint8_t*)data, sizeof(DeviceData));
-    if (state == RADIOLIB_ERR_NONE)
+    if (len == 0 || len > WIRE_MAX_FRAME_LEN)
+        return false;
+
+    txFrame frame;
+    memcpy(frame.data, data, len);
+    frame.len = len;
+    // Frame data harus di-ACK oleh base
+    FrameHeader hdr;
+    frame.needsAck = decodeHeader(data, len, hdr) && isDataFrame(hdr.type);
+    frame.urgent = urgent || (frame.needsAck && hdr.type == FRAME_URGENT);
+    frame.device_id = hdr.device_id;
+    frame.seq = hdr.seq;
+    frame.queuedAt = millis();
+    if (frame.urgent)
+    {
+        if (urgentQueue.push(frame))
+            return true;
+        Serial.println(F("[LoRa] Urgent queue full, SOS frame dropped"));
+        return false;
+    }
+    if (!txQueue.push(frame))
+    {
+        Serial.println(F("[LoRa] TX queue full, frame dropped"));
+        return false;
+    }
+    return true;
+}
+
+// Frame berikutnya: SOS, lalu frame yang didahului SOS, lalu antrian biasa
+bool LoRaHandler::nextFrame()
+{
+    if (urgentQueue.pop(txCurrent))
+    {
+        txAttempts = 0;
+        return true;
+    }
+    if (txHasParked)
+    {
+        txCurrent = txParked;
+        txAttempts = txParkedAttempts;
+        txHasParked = false;
+        return true;
+    }
+    if (txQueue.pop(txCurrent))
+    {
+        txAttempts = 0;
+        return true;
+    }
+    return false;
+}
+
+// Frame biasa yang sedang menunggu retry/slot disimpan dulu supaya SOS
+// langsung dikirim. Frame yang sedang on-air atau menunggu ACK tidak
+// diganggu (paling lama satu jendela ACK).
+bool LoRaHandler::preempt()
+{
+    if (txCurrent.urgent || txHasParked || urgentQueue.empty())
+        return false;
+    txParked = txCurrent;
+    txParkedAttempts = txAttempts;
+    txHasParked = true;
+    Serial.printf("[LoRa] SOS preempts seq %u\n", txCurrent.seq);
+    return true;
+}
+
+void LoRaHandler::startTx(uint8_t channel, uint8_t sf)
+{
+    tune(channel);
+    setSf(sf);
+    setPower(txPower);
+    txSf = sf;
+    dio1Fired = false;
+    int state = radio.startTransmit(txCurrent.data, txCurrent.len);
+    if (txAttempts < UINT8_MAX)
+        txAttempts++;
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.print(F("[LoRa] startTransmit error: "));
+        Serial.println(state);
+        txFailed++;
+        scheduleRetry();
+        return;
+    }
+    chStats[channel].tx++;
+    txState = TxState::TRANSMITTING;
+    txStateTick = millis();
+    // getTimeOnAir dalam mikrodetik, beri margin 2x + 100 ms
+    txTimeoutMs = radio.getTimeOnAir(txCurrent.len) / 500 + 100;
+}
+
+void LoRaHandler::scheduleRetry()
+{
+    idleRadio();
+    // SOS tidak pernah menyerah
+    if (!txCurrent.needsAck || (!txCurrent.urgent && txAttempts > LORA_MAX_RETRIES))
+    {
+        if (txCurrent.needsAck)
+        {
+            txNoAck++;
+            Serial.printf("[LoRa] Frame seq %u not acknowledged, giving up\n", txCurrent.seq);
+        }
+        txState = TxState::IDLE;
+        return;
+    }
+    // Dengan TDMA cukup tunggu slot berikutnya
+    if (beaconListen && slotClock.synced(millis()))
+    {
+        txSlotAt = 0;
+        txState = TxState::WAIT_SLOT;
+        return;
+    }
+    // Exponential backoff + jitter supaya client tidak bertabrakan lagi
+    uint32_t backoff;
+    if (txCurrent.urgent)
+    {
+        uint8_t shift = txAttempts > 4 ? 4 : txAttempts - 1;
+        backoff = min(LORA_SOS_BACKOFF_MS << shift, LORA_SOS_BACKOFF_MAX_MS) + random(LORA_SOS_BACKOFF_MS);
+    }
+    else
+    {
+        backoff = (LORA_RETRY_BACKOFF_MS << (txAttempts - 1)) + random(LORA_RETRY_BACKOFF_MS);
+    }
+    txRetryAt = millis() + backoff;
+    txState = TxState::BACKOFF;
+}
+
+// Baca frame yang diterima: beacon memperbarui jadwal slot, return true
+// hanya untuk ACK frame yang sedang dikirim
+bool LoRaHandler::readFrame()
+{
+    uint32_t tick = dio1Tick;
+    uint8_t buf[WIRE_MAX_FRAME_LEN];
+    size_t len = radio.getPacketLength();
+    if (len > sizeof(buf))
+        len = sizeof(buf);
+    if (radio.readData(buf, len) != RADIOLIB_ERR_NONE)
+        return false;
+
+    FrameHeader hdr;
+    if (!decodeHeader(buf, len, hdr))
+        return false;
+    if (hdr.type == FRAME_BEACON)
+    {
+        Beacon beacon;
+        if (beaconListen && decodeBeacon(buf, len, beacon))
+        {
+            bool wasSynced = slotClock.synced(tick);
+            slotClock.onBeacon(beacon, tick, beaconDeviceId, plan.preambleLength());
+            beaconsHeard++;
+            if (!wasSynced)
+                Serial.printf("[LoRa] TDMA synced, %u slots, %s\n", beacon.count,
+                              slotClock.assigned() ? "own slot" : "contention");
+        }
+        return false;
+    }
+    int8_t margin;
+    if (hdr.type != FRAME_ACK || hdr.device_id != txCurrent.device_id || hdr.seq != txCurrent.seq ||
+        !decodeAck(buf, len, hdr, margin))
+        return false;
+
+    // ADR: daya TX berikutnya dari margin frame ini di base
+    txMargin = margin;
+    int8_t power = adrNextPower(txPower, margin, txSf, adr);
+    if (power != txPower)
+    {
+        Serial.printf("[LoRa] ADR: margin %d dB at SF%u, power %d -> %d dBm\n", margin, txSf, txPower, power);
+        txPower = power;
+    }
+    return true;
+}
+
+void LoRaHandler::listenForBeacons(uint8_t device_id)
+{
+    beaconDeviceId = device_id;
+    beaconListen = true;
+    dio1Fired = false;
+    tune(0);
+    radio.startReceive();
+}
+
+void LoRaHandler::idleRadio()
+{
+    // Receiver tetap hidup di channel kontrol supaya beacon tidak terlewat
+    if (beaconListen)
+    {
+        tune(0);
+        setSf(LORA_SF_MIN);
+        radio.startReceive();
+    }
+    else
+    {
+        radio.standby();
+    }
+}
+
+void LoRaHandler::pollBeacon()
+{
+    if (!beaconListen || !dio1Fired)
+        return;
+    dio1Fired = false;
+    readFrame();
+    radio.startReceive();
+}
+
+// true jika frame boleh dikirim sekarang. Tanpa sinkron TDMA selalu true
+// (ALOHA). Di slot contention waktu mulai diacak dalam jendela slot.
+bool LoRaHandler::slotDue(uint32_t now)
+{
+    if (!beaconListen || !slotClock.synced(now))
+    {
+        txChannel = plan.hop(txCurrent.device_id, txCurrent.seq + txAttempts);
+        txSf = LORA_SF_MIN;
+        return true;
+    }
+    if (txSlotAt && (int32_t)(now - txSlotAt) < 0)
+        return false;
+
+    SlotWindow window;
+    uint32_t airMs = radio.getTimeOnAir(txCurrent.len) / 1000;
+    slotClock.nextWindow(now, txCurrent.urgent, airMs, window);
+    if (window.start != now)
+    {
+        txSlotAt = 0;
+        return false;
+    }
+    if (window.contention && !txSlotAt)
+    {
+        txSlotAt = now + random(window.length + 1);
+        if (txSlotAt != now)
+            return false;
+    }
+    txSlotAt = 0;
+    txChannel = plan.slotChannel(window.slot, window.frameSeq);
+    txSf = window.sf;
+    return true;
+}
+
+void LoRaHandler::poll()
+{
+    uint32_t now = millis();
+    if ((txState == TxState::BACKOFF || txState == TxState::WAIT_SLOT) && preempt())
+    {
+        idleRadio();
+        txState = TxState::IDLE;
+    }
+    switch (txState)
+    {
+    case TxState::TRANSMITTING:
+        if (dio1Fired)
+        {
+            dio1Fired = false;
+            radio.finishTransmit();
+            txSent++;
+            if (!txCurrent.needsAck)
+            {
+                idleRadio();
+                txState = TxState::IDLE;
+                return;
+            }
+            // Buka jendela RX untuk ACK
+            radio.startReceive();
+            txState = TxState::WAIT_ACK;
+            txStateTick = now;
+        }
+        else if (now - txStateTick >= txTimeoutMs)
+        {
+            Serial.println(F("[LoRa] TX timeout"));
+            radio.finishTransmit();
+            txFailed++;
+            scheduleRetry();
+        }
+        return;
+
+    case TxState::WAIT_ACK:
+        if (dio1Fired)
+        {
+            dio1Fired = false;
+            if (readFrame())
+            {
+                idleRadio();
+                txAcked++;
+                if (txCurrent.urgent)
+                {
+                    uint32_t ms = now - txCurrent.queuedAt;
+                    sosLatency.record(ms, SOS_LORA_BUDGET_MS);
+                    Serial.printf("[LoRa] SOS seq %u acknowledged after %lu ms, %u attempts%s\n", txCurrent.seq, ms,
+                                  txAttempts, ms > SOS_LORA_BUDGET_MS ? " (over budget)" : "");
+                }
+                txState = TxState::IDLE;
+                return;
+            }
+            radio.startReceive();
+        }
+        if (now - txStateTick >= loraAckWindowMs(txSf))
+            scheduleRetry();
+        return;
+
+    case TxState::BACKOFF:
+        pollBeacon();
+        if ((int32_t)(now - txRetryAt) < 0)
+            return;
+        txRetries++;
+        Serial.printf("[LoRa] Retransmit seq %u (attempt %u)\n", txCurrent.seq, txAttempts + 1);
+        startTx(plan.hop(txCurrent.device_id, txCurrent.seq + txAttempts), LORA_SF_MIN);
+        return;
+
+    case TxState::WAIT_SLOT:
+        pollBeacon();
+        if (!slotDue(now))
+            return;
+        if (txAttempts)
+        {
+            txRetries++;
+            Serial.printf("[LoRa] Retransmit seq %u in slot (attempt %u)\n", txCurrent.seq, txAttempts + 1);
+        }
+        startTx(txChannel, txSf);
+        return;
+
+    case TxState::IDLE:
+        pollBeacon();
+        if (!nextFrame())
+            return;
+        txSlotAt = 0;
+        if (!slotDue(now))
+        {
+            txState = TxState::WAIT_SLOT;
+            return;
+        }
+        startTx(txChannel, txSf);
+        return;
+    }
+}
+
+LoRaTxStats LoRaHandler::txStats() const
+{
+    LoRaTxStats stats;
+    stats.queued = txQueue.size();
+    stats.inFlight = txState != TxState::IDLE;
+    stats.sent = txSent;
+    stats.failed = txFailed;
+    stats.dropped = txQueue.dropped() + urgentQueue.dropped();
+    stats.acked = txAcked;
+    stats.retries = txRetries;
+    stats.noAck = txNoAck;
+    stats.beacons = beaconsHeard;
+    stats.synced = beaconListen && slotClock.synced(millis());
+    stats.slotSf = slotClock.slotSf();
+    stats.power = txPower;
+    stats.margin = txMargin;
+    stats.urgentQueued = urgentQueue.size();
+    stats.sos = sosLatency;
+    return stats;
+}
+
+#ifdef DEVICE_MODE_BASE
+// ===========================================
+// Continuous receive (RX task)
+// ===========================================
+
+void LoRaHandler::rxTask(void *param)
+{
+    LoRaHandler *self = (LoRaHandler *)param;
+    while (true)
+    {
+        // ALOHA multi-channel: radio tunggal tidak bisa mendengar semua
+        // channel sekaligus, jadi channel di-scan bergantian dengan CAD
+        if (!self->beaconing && self->plan.count > 1)
+        {
+            self->scanChannels();
+            continue;
+        }
+
+        TickType_t wait = portMAX_DELAY;
+        if (self->beaconing)
+        {
+            int32_t left = (int32_t)(self->nextSlotAt - millis());
+            wait = left > 0 ? pdMS_TO_TICKS(left) : 0;
+        }
+        if (ulTaskNotifyTake(pdTRUE, wait) == 0)
+        {
+            // Timeout: batas slot, pindah channel atau kirim beacon
+            self->nextSlot();
+            continue;
+        }
+        self->handleRx();
+        self->radio.startReceive();
+    }
+}
+
+void LoRaHandler::handleRx()
+{
+    rawFrame frame;
+    size_t len = radio.getPacketLength();
+    if (len > sizeof(frame.data))
+        len = sizeof(frame.data);
+    int state = radio.readData(frame.data, len);
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.print(F("[LoRa] RX error: "));
+        Serial.println(state);
+        return;
+    }
+
+    frame.len = len;
+    frame.sf = currentSf;
+    frame.rssi = radio.getRSSI();
+    frame.snr = radio.getSNR();
+    frame.rxTick = millis();
+    chStats[currentChannel].rx++;
+    FrameHeader hdr;
+    bool data = decodeHeader(frame.data, len, hdr) && isDataFrame(hdr.type);
+    // SOS punya antrian sendiri supaya tidak tertahan frame biasa
+    bool urgent = data && hdr.type == FRAME_URGENT;
+    bool queued = urgent ? rxUrgent.push(frame) : rxQueue.push(frame);
+    if (!queued)
+        Serial.printf("[LoRa] RX %squeue full, frame dropped\n", urgent ? "urgent " : "");
+    // Duplikat tetap di-ACK, mungkin ACK sebelumnya yang hilang.
+    // Frame yang dibuang tidak di-ACK supaya client mengirim ulang
+    // (back-pressure saat uplink tersendat). ACK dikirim di channel
+    // yang sama dengan frame, di sana client menunggu.
+    if (data && beaconing)
+        slots.heard(hdr.device_id, frame.snr);
+    if (queued && data)
+        sendAck(hdr.device_id, hdr.seq, linkMargin(frame.snr, currentSf));
+}
+
+void LoRaHandler::nextSlot()
+{
+    if (slotIndex > superframe.count)
     {
-        Serial.println(F("[LoRa] Data received"));
-        memcpy(&packet_data.device_data, data, sizeof(DeviceData));
-        packet_data.isNew = true;
-        packet_data.rssi = radio.getRSSI();
-        packet_data.snr = radio.getSNR();
-        Serial.printf("[LoRa] RSSI: %d, SNR: %.1f\n", packet_data.rssi, packet_data.snr);
+        // Superframe selesai: beacon di channel dan SF kontrol
+        tune(0);
+        setSf(LORA_SF_MIN);
+        sendBeacon();
+        superframeMs = tdmaSuperframeMs(superframe, plan.preambleLength());
+        slotIndex = 0;
+        // Superframe dihitung dari akhir beacon, sama dengan patokan client
+        nextSlotAt = millis() + TDMA_BEACON_GUARD_MS;
+    }
+    else
+    {
+        uint8_t sf = slotIndex ? superframe.sf[slotIndex - 1] : LORA_SF_MIN;
+        tune(plan.slotChannel(slotIndex, superframe.seq));
+        setSf(sf);
+        nextSlotAt += tdmaSlotMs(superframe.slotMs, sf);
+        slotIndex++;
+    }
+    radio.startReceive();
+}
+
+void LoRaHandler::scanChannels()
+{
+    for (uint8_t ch = 0; ch < plan.count; ch++)
+    {
+        tune(ch);
+        int state = radio.scanChannel();
+        // CAD done juga memicu DIO1, buang notifikasinya
+        ulTaskNotifyTake(pdTRUE, 0);
+        dio1Fired = false;
+        chStats[ch].scans++;
+        if (state != RADIOLIB_LORA_DETECTED)
+            continue;
+
+        chStats[ch].activity++;
+        radio.startReceive();
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LORA_SCAN_RX_TIMEOUT_MS)))
+            handleRx();
+        radio.standby();
+        ulTaskNotifyTake(pdTRUE, 0);
+        dio1Fired = false;
+    }
+    // CAD di RadioLib polling, beri waktu task lain di core ini
+    vTaskDelay(1);
+}
+
+void LoRaHandler::sendAck(uint8_t device_id, uint8_t seq, int8_t margin)
+{
+    uint8_t buf[8];
+    size_t len = encodeAck(device_id, seq, margin, buf, sizeof(buf));
+    vTaskDelay(pdMS_TO_TICKS(LORA_ACK_DELAY_MS));
+    int state = radio.transmit(buf, len);
+    // TX done juga memicu DIO1, buang notifikasinya
+    ulTaskNotifyTake(pdTRUE, 0);
+    dio1Fired = false;
+    if (state == RADIOLIB_ERR_NONE)
+        acksSent++;
+    else
+        Serial.printf("[LoRa] ACK TX error: %d\n", state);
+}
+
+void LoRaHandler::sendBeacon()
+{
+    slots.nextBeacon(superframe);
+    uint8_t buf[WIRE_MAX_FRAME_LEN];
+    size_t len = encodeBeacon(superframe, buf, sizeof(buf));
+    int state = radio.transmit(buf, len);
+    ulTaskNotifyTake(pdTRUE, 0);
+    dio1Fired = false;
+    if (state == RADIOLIB_ERR_NONE)
+        beaconsSent++;
+    else
+        Serial.printf("[LoRa] Beacon TX error: %d\n", state);
+}
+
+bool LoRaHandler::startListening(uint16_t slotMs)
+{
+    if (rxTaskHandle)
         return true;
+
+    if (slotMs)
+    {
+        slots.setSlotMs(slotMs);
+        // Beacon pertama setelah startReceive() di bawah selesai.
+        // slotIndex > superframe.count: slot berikutnya adalah beacon.
+        nextSlotAt = millis() + slotMs;
+        slotIndex = 1;
+        superframe.count = 0;
+        beaconing = true;
+    }
+
+    // Task dibuat dulu supaya interrupt pertama sudah punya tujuan
+    xTaskCreatePinnedToCore(rxTask, "LoRa RX", 4096, this, 3, &rxTaskHandle, 1);
+    int state = radio.startReceive();
+    if (state != RADIOLIB_ERR_NONE)
+    {
+        Serial.print(F("[LoRa] startReceive failed: "));
+        Serial.println(state);
+        vTaskDelete(rxTaskHandle);
+        rxTaskHandle = nullptr;
+        return false;
+    }
+    Serial.println(F("[LoRa] Continuous RX started"));
+    return true;
+}
+
+bool LoRaHandler::decodePacket(const rawFrame &frame, bool urgent)
+{
+    Serial.printf("[LoRa] %s received, %u bytes\n", urgent ? "SOS" : "Data", (unsigned)frame.len);
+    FrameHeader hdr;
+    packet_data.count = decodeFrame(frame.data, frame.len, hdr, packet_data.records, BATCH_MAX_RECORDS);
+    if (packet_data.count == 0)
+    {
+        Serial.println(F("[LoRa] Invalid frame"));
+        return false;
+    }
+    uint32_t gapsBefore = seqTracker.gaps();
+    bool duplicate = seqTracker.isDuplicate(hdr.device_id, hdr.seq, hdr.boot, hdr.bootId);
+    if (devices)
+        devices->onFrame(hdr.device_id, hdr.seq, frame.rssi, frame.snr, frame.sf, duplicate,
+                         (int32_t)(seqTracker.gaps() - gapsBefore), millis());
+    if (duplicate)
+    {
+        Serial.printf("[LoRa] Duplicate seq %u from device %u, dropped\n", hdr.seq, hdr.device_id);
+        return false;
+    }
+    rxReceived++;
+    if (urgent)
+        rxUrgentCount++;
+    packet_data.device_id = hdr.device_id;
+    packet_data.seq = hdr.seq;
+    packet_data.isNew = true;
+    packet_data.rssi = frame.rssi;
+    packet_data.snr = frame.snr;
+    packet_data.rxTick = frame.rxTick;
+    packet_data.urgent = urgent;
+    Serial.printf("[LoRa] RSSI: %d, SNR: %.1f\n", packet_data.rssi, packet_data.snr);
+    return true;
+}
+
+LoRaRxStats LoRaHandler::rxStats() const
+{
+    LoRaRxStats stats;
+    stats.received = rxReceived;
+    stats.duplicates = seqTracker.duplicates();
+    stats.gaps = seqTracker.gaps();
+    stats.dropped = rxQueue.dropped() + rxUrgent.dropped();
+    stats.acksSent = acksSent;
+    stats.beacons = beaconsSent;
+    stats.slots = slots.assigned();
+    stats.urgent = rxUrgentCount;
+    stats.superframeMs = superframeMs;
+    return stats;
+}
+
+bool LoRaHandler::receive(bool urgentOnly)
+{
+    rawFrame frame;
+    // Mode continuous: ambil satu frame dari ring buffer, SOS dulu
+    if (isListening())
+    {
+        while (rxUrgent.pop(frame))
+        {
+            if (decodePacket(frame, true))
+                return true;
+        }
+        if (urgentOnly)
+            return false;
+        while (rxQueue.pop(frame))
+        {
+            if (decodePacket(frame, false))
+                return true;
+        }
+        return false;
+    }
+
+    size_t len = sizeof(frame.data);
+    int state = radio.receive(frame.data, len);
+    if (state == RADIOLIB_ERR_NONE)
+    {
+        len = radio.getPacketLength();
+        frame.len = len > sizeof(frame.data) ? sizeof(frame.data) : len;
+        frame.rssi = radio.getRSSI();
+        frame.snr = radio.getSNR();
+        frame.sf = currentSf;
+        frame.rxTick = millis();
+        FrameHeader hdr;
+        bool urgent = decodeHeader(frame.data, frame.len, hdr) && hdr.type == FRAME_URGENT;
+        return decodePacket(frame, urgent);
     }
     else if (state != RADIOLIB_ERR_RX_TIMEOUT)
     {
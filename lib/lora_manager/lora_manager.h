@@ -2,12 +2,98 @@
 #include <Arduino.h>
 #include <RadioLib.h>
 #include <data.h>
+#include <lora_packet.h>
+#include <tdma.h>
+#include <channel_plan.h>
+#include <ring_buffer.h>
+#ifdef DEVICE_MODE_BASE
+#include <device_table.h>
+#endif
+
+// Frame yang menunggu dikirim (async TX)
+struct txFrame {
+    uint8_t data[WIRE_MAX_FRAME_LEN];
+    uint8_t len;
+    bool needsAck;
+    bool urgent;       // SOS: antrian prioritas, slot contention, ulang sampai ACK
+    uint8_t device_id;
+    uint8_t seq;
+    uint32_t queuedAt; // millis() saat enqueue, untuk latensi SOS
+};
+static constexpr size_t LORA_TX_QUEUE_LEN = 9; // 8 frame
+static constexpr size_t LORA_URGENT_QUEUE_LEN = 3; // 2 frame
+
+struct LoRaTxStats {
+    uint32_t queued;   // frame di antrian
+    bool inFlight;     // sedang on-air
+    uint32_t sent;
+    uint32_t failed;   // startTransmit error atau TX timeout
+    uint32_t dropped;  // antrian penuh
+    uint32_t acked;
+    uint32_t retries;  // retransmit karena ACK tidak datang
+    uint32_t noAck;    // menyerah setelah LORA_MAX_RETRIES
+    uint32_t beacons;  // beacon TDMA yang diterima
+    bool synced;       // TX mengikuti slot dari beacon
+    uint8_t slotSf;    // SF slot sendiri dari beacon (ADR)
+    int8_t power;      // daya TX sekarang, dBm (ADR)
+    int8_t margin;     // link margin di ACK terakhir, dB
+    uint32_t urgentQueued;
+    SosLatency sos;    // enqueue SOS -> ACK base
+};
+// Statistik per channel. Di base, scans/activity dari CAD (mode scan)
+// menunjukkan okupansi channel.
+struct LoRaChannelStats {
+    float freq;
+    uint32_t tx;
+    uint32_t rx;
+    uint32_t scans;
+    uint32_t activity;
+};
+
+static constexpr uint8_t LORA_MAX_RETRIES = 3;
+// Daya TX awal (dBm), ADR client menurunkannya jika margin berlebih
+static constexpr int8_t LORA_TX_POWER = 14;
+static constexpr uint32_t LORA_RETRY_BACKOFF_MS = 500;
+// Frame SOS tidak dibatasi LORA_MAX_RETRIES, backoff lebih pendek dan dibatasi
+static constexpr uint32_t LORA_SOS_BACKOFF_MS = 200;
+static constexpr uint32_t LORA_SOS_BACKOFF_MAX_MS = 2000;
 
 #ifdef DEVICE_MODE_BASE
+// Frame mentah dari ISR/RX task, di-decode di main loop
+struct rawFrame {
+    uint8_t data[WIRE_MAX_FRAME_LEN];
+    uint8_t len;
+    uint8_t sf;
+    float snr;
+    int rssi;
+    uint32_t rxTick; // millis() saat diterima
+};
+static constexpr size_t LORA_RX_QUEUE_LEN = 9; // 8 frame
+static constexpr size_t LORA_RX_URGENT_LEN = 5; // 4 frame SOS
+// Setelah CAD mendeteksi preamble: sisa preamble + frame 64 byte
+static constexpr uint32_t LORA_SCAN_RX_TIMEOUT_MS = 250;
+
+struct LoRaRxStats {
+    uint32_t received;
+    uint32_t duplicates;
+    uint32_t gaps;      // frame hilang menurut seq
+    uint32_t dropped;   // antrian RX (biasa + SOS) penuh
+    uint32_t acksSent;
+    uint32_t beacons;   // beacon TDMA terkirim
+    uint8_t slots;      // device yang punya slot
+    uint32_t urgent;    // frame SOS yang diterima
+    uint32_t superframeMs; // superframe terakhir termasuk airtime beacon
+};
+
 struct receivedPacket {
-    DeviceData device_data;
+    DeviceData records[BATCH_MAX_RECORDS];
+    uint8_t count;
+    uint8_t device_id;
+    uint8_t seq;
     float snr;
     int rssi;
+    uint32_t rxTick;
+    bool urgent;
     bool isNew;
 };
 #endif
@@ -17,12 +103,44 @@ class LoRaHandler
 public:
     LoRaHandler(int nss, int dio1, int rst, int busy, int sck, int miso, int mosi);
     bool begin(float frequency);
+    // Pakai beberapa channel. Client hop per frame (ALOHA) atau per slot
+    // (TDMA); base scan dengan CAD (ALOHA) atau pindah channel per slot.
+    bool setChannelPlan(const ChannelPlan &plan);
+    uint8_t channelCount() const { return plan.count; }
+    LoRaChannelStats channelStats(uint8_t ch) const;
+    // Batas ADR: base memakai batas SF untuk slot TDMA, client memakai
+    // batas daya TX
+    void setAdrLimits(const AdrLimits &limits);
 
     void sendMessage(const String &message);
     bool receiveMessage(String &message, int &rssi, float &snr);
     void transmit(const uint8_t* data, size_t len);
+
+    // Async TX: enqueue tidak pernah blocking, poll() dipanggil dari loop()
+    // untuk menyelesaikan TX (DIO1) dan memulai frame berikutnya.
+    // Frame urgent (atau FRAME_URGENT) masuk antrian prioritas, mendahului
+    // frame biasa yang sedang menunggu retry, dan dikirim ulang sampai di-ACK.
+    bool enqueue(const uint8_t *data, size_t len, bool urgent = false);
+    void poll();
+    // Client: dengarkan beacon base dan kirim hanya di slot sendiri
+    // (atau slot contention). Tanpa beacon TX kembali ke ALOHA.
+    void listenForBeacons(uint8_t device_id);
+    bool txIdle() const
+    {
+        return txState == TxState::IDLE && txQueue.empty() && urgentQueue.empty() && !txHasParked;
+    }
+    LoRaTxStats txStats() const;
     #ifdef DEVICE_MODE_BASE
-    bool receive();
+    // Continuous RX: DIO1 interrupt -> RX task -> ring buffer.
+    // slotMs > 0: RX task juga mengirim beacon TDMA tiap superframe
+    bool startListening(uint16_t slotMs = 0);
+    bool isListening() const { return rxTaskHandle != nullptr; }
+    LoRaRxStats rxStats() const;
+    // Statistik link per device diisi dari decodePacket()
+    void attachDeviceTable(DeviceTable *table) { devices = table; }
+    // Ambil satu frame: SOS dulu, frame biasa hanya jika !urgentOnly
+    // (urgentOnly dipakai saat uplink tersendat)
+    bool receive(bool urgentOnly = false);
     receivedPacket getNewPacket(){
         receivedPacket temp = packet_data;
         packet_data.isNew = false;
@@ -34,8 +152,89 @@ public:
 private:
     int _nss, _dio1, _rst, _busy;
     int _sck, _miso, _mosi;
+
+    static LoRaHandler *instance;
+    static volatile bool dio1Fired;
+    static volatile uint32_t dio1Tick; // millis() saat DIO1, untuk sinkron slot
+
+    ChannelPlan plan = {{0}, 1};
+    uint8_t currentChannel = 0;
+    LoRaChannelStats chStats[CHANNEL_PLAN_MAX] = {};
+    void tune(uint8_t ch);
+    AdrLimits adr = ADR_DEFAULT_LIMITS;
+    uint8_t currentSf = LORA_SF_MIN;
+    int8_t currentPower = LORA_TX_POWER;
+    void setSf(uint8_t sf);
+    void setPower(int8_t dbm);
+    static void onDio1();
+
+    enum class TxState : uint8_t { IDLE, TRANSMITTING, WAIT_ACK, BACKOFF, WAIT_SLOT };
+    RingBuffer<txFrame, LORA_TX_QUEUE_LEN> txQueue;
+    RingBuffer<txFrame, LORA_URGENT_QUEUE_LEN> urgentQueue;
+    txFrame txCurrent;
+    // Frame biasa yang didahului SOS saat menunggu retry
+    txFrame txParked;
+    bool txHasParked = false;
+    uint8_t txParkedAttempts = 0;
+    SosLatency sosLatency;
+    TxState txState = TxState::IDLE;
+    uint8_t txAttempts = 0;
+    uint32_t txStateTick = 0;
+    uint32_t txTimeoutMs = 0;
+    uint32_t txRetryAt = 0;
+    uint32_t txSent = 0;
+    uint32_t txFailed = 0;
+    uint32_t txAcked = 0;
+    uint32_t txRetries = 0;
+    uint32_t txNoAck = 0;
+    uint8_t txChannel = 0;
+    uint8_t txSf = LORA_SF_MIN;
+    int8_t txPower = LORA_TX_POWER;
+    int8_t txMargin = 0;
+    void startTx(uint8_t channel, uint8_t sf);
+    void scheduleRetry();
+    bool readFrame();
+    bool nextFrame();
+    bool preempt();
+
+    SlotClock slotClock;
+    bool beaconListen = false;
+    uint8_t beaconDeviceId = 0;
+    uint32_t txSlotAt = 0;
+    uint32_t beaconsHeard = 0;
+    bool slotDue(uint32_t now);
+    void pollBeacon();
+    void idleRadio();
+
     #ifdef DEVICE_MODE_BASE
     receivedPacket packet_data;
+    TaskHandle_t rxTaskHandle = nullptr;
+    RingBuffer<rawFrame, LORA_RX_QUEUE_LEN> rxQueue;
+    RingBuffer<rawFrame, LORA_RX_URGENT_LEN> rxUrgent;
+    uint32_t rxUrgentCount = 0;
+
+    SeqTracker seqTracker;
+    DeviceTable *devices = nullptr;
+    uint32_t rxReceived = 0;
+    uint32_t acksSent = 0;
+
+    SlotAssigner slots;
+    bool beaconing = false;
+    // Superframe yang sedang berjalan (beacon terakhir), slot berikutnya
+    // dan waktunya
+    Beacon superframe = {};
+    uint8_t slotIndex = 1;
+    uint32_t nextSlotAt = 0;
+    uint32_t superframeMs = 0;
+    uint32_t beaconsSent = 0;
+
+    static void rxTask(void *param);
+    void handleRx();
+    void nextSlot();
+    void scanChannels();
+    void sendAck(uint8_t device_id, uint8_t seq, int8_t margin);
+    void sendBeacon();
+    bool decodePacket(const rawFrame &frame, bool urgent);
     #endif
 
     SPIClass spi;
@@ -0,0 +1,48 @@
+#include "adr.h"
+
+int8_t linkMargin(float snr, uint8_t sf)
+{
+    float m = snr - loraSnrFloor(sf);
+    if (m > 127.0f)
+        return 127;
+    if (m < -128.0f)
+        return -128;
+    return (int8_t)lroundf(m);
+}
+
+uint8_t adrInitialSf(float snr, const AdrLimits &limits)
+{
+    uint8_t sf = limits.minSf;
+    while (sf < limits.maxSf && snr - loraSnrFloor(sf) < ADR_MARGIN_DB)
+        sf++;
+    return sf;
+}
+
+uint8_t adrNextSf(uint8_t sf, float snr, const AdrLimits &limits)
+{
+    float headroom = snr - loraSnrFloor(sf) - ADR_MARGIN_DB;
+    if (headroom < 0 && sf < limits.maxSf)
+        return sf + 1;
+    // Turun hanya jika SF yang lebih cepat masih menyisakan hysteresis
+    if (headroom >= ADR_SF_STEP_DB + ADR_HYSTERESIS_DB && sf > limits.minSf)
+        return sf - 1;
+    if (sf < limits.minSf)
+        return limits.minSf;
+    if (sf > limits.maxSf)
+        return limits.maxSf;
+    return sf;
+}
+
+int8_t adrNextPower(int8_t power, int8_t margin, uint8_t sf, const AdrLimits &limits)
+{
+    float headroom = margin - ADR_MARGIN_DB;
+    // Link memburuk: langsung daya penuh, base menaikkan SF jika masih kurang
+    if (headroom < 0)
+        return limits.maxPower;
+    // Daya baru diturunkan setelah SF di batas bawah
+    if (sf > limits.minSf || headroom < ADR_POWER_STEP_DB + ADR_HYSTERESIS_DB)
+        return power;
+    int steps = (int)((headroom - ADR_HYSTERESIS_DB) / ADR_POWER_STEP_DB);
+    int next = power - steps * ADR_POWER_STEP_DB;
+    return next < limits.minPower ? limits.minPower : (int8_t)next;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include "lora_packet.h"
+
+// ===========================================
+// ADR (adaptive data rate)
+// ===========================================
+// SX1262 hanya bisa menerima satu SF dalam satu waktu, jadi SF slot
+// ditentukan base (dari SNR frame device) dan diumumkan di beacon.
+// Daya TX ditentukan client dari link margin di setiap ACK. Urutan
+// seperti LoRaWAN: SF diturunkan dulu sampai batas bawah, baru daya.
+//
+// Beacon, slot contention dan ALOHA selalu di SF kontrol (LORA_SF_MIN),
+// ADR SF hanya berlaku di slot TDMA milik device.
+
+// Margin yang disisakan di atas batas demodulasi
+static constexpr float ADR_MARGIN_DB = 6.0f;
+// Selisih batas demodulasi antar SF
+static constexpr float ADR_SF_STEP_DB = 2.5f;
+static constexpr float ADR_HYSTERESIS_DB = 2.0f;
+static constexpr int8_t ADR_POWER_STEP_DB = 2;
+// EWMA SNR per device di base: avg += (x - avg) / 2^shift
+static constexpr uint8_t ADR_EWMA_SHIFT = 2;
+
+struct AdrLimits
+{
+    uint8_t minSf;  // >= LORA_SF_MIN
+    uint8_t maxSf;  // <= LORA_SF_MAX
+    int8_t minPower; // dBm
+    int8_t maxPower;
+};
+
+static constexpr AdrLimits ADR_DEFAULT_LIMITS = {LORA_SF_MIN, LORA_SF_MAX, 2, 14};
+
+// SNR minimum demodulasi SX126x (BW 125 kHz)
+inline float loraSnrFloor(uint8_t sf)
+{
+    return -7.5f - ADR_SF_STEP_DB * (sf - 7);
+}
+
+// SNR di atas batas demodulasi, dibulatkan dan di-clamp ke int8 untuk ACK
+int8_t linkMargin(float snr, uint8_t sf);
+
+// Base: SF untuk device baru dengan SNR snr (SF tercepat yang masih
+// menyisakan ADR_MARGIN_DB)
+uint8_t adrInitialSf(float snr, const AdrLimits &limits);
+// Base: SF slot berikutnya, paling banyak satu step per superframe
+uint8_t adrNextSf(uint8_t sf, float snr, const AdrLimits &limits);
+// Client: daya TX berikutnya dari margin frame terakhir yang dikirim di SF sf
+int8_t adrNextPower(int8_t power, int8_t margin, uint8_t sf, const AdrLimits &limits);
@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+static constexpr uint8_t CHANNEL_PLAN_MAX = 8;
+// Preamble normal, ditambah per channel saat base scan dengan CAD supaya
+// preamble masih berjalan ketika base sampai di channel frame tersebut
+static constexpr uint16_t LORA_PREAMBLE_LEN = 8;
+static constexpr uint16_t LORA_SCAN_SYMBOLS_PER_CHANNEL = 4;
+
+// Daftar frekuensi (MHz). Channel 0 adalah channel kontrol: beacon TDMA,
+// slot contention, dan tempat client menunggu beacon.
+struct ChannelPlan
+{
+    float freqs[CHANNEL_PLAN_MAX];
+    uint8_t count;
+
+    // ALOHA: channel per frame dari device_id dan seq (retry = seq + attempt)
+    uint8_t hop(uint8_t device_id, uint8_t seq) const
+    {
+        return count > 1 ? (uint8_t)((device_id + seq) % count) : 0;
+    }
+
+    // TDMA: channel slot ke-slot pada superframe frameSeq. Slot contention
+    // tetap di channel kontrol, slot device berputar di channel lainnya.
+    uint8_t slotChannel(uint8_t slot, uint8_t frameSeq) const
+    {
+        if (count <= 1 || slot == 0)
+            return 0;
+        return 1 + (uint8_t)((slot - 1 + frameSeq) % (count - 1));
+    }
+
+    uint16_t preambleLength() const
+    {
+        return count > 1 ? LORA_PREAMBLE_LEN + LORA_SCAN_SYMBOLS_PER_CHANNEL * count : LORA_PREAMBLE_LEN;
+    }
+};
+
+// AS923-1: 923.2/923.4 MHz channel default, sisanya channel tambahan
+// yang umum dipakai di 922-923 MHz
+static constexpr ChannelPlan AS923_PLAN = {{923.2f, 923.4f, 922.2f, 922.4f, 922.6f, 922.8f, 923.0f, 922.0f}, 8};
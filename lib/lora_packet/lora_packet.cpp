@@ -0,0 +1,512 @@
+#include "lora_packet.h"
+#include <math.h>
+
+// ===========================================
+// Bit-stream helper
+// ===========================================
+BitWriter::BitWriter(uint8_t *buf, size_t cap)
+    : buf(buf), cap(cap), bitPos(0), overflowed(false)
+{
+    memset(buf, 0, cap);
+}
+
+void BitWriter::write(uint32_t value, uint8_t bits)
+{
+    if (bitPos + bits > cap * 8)
+    {
+        overflowed = true;
+        return;
+    }
+    for (uint8_t i = 0; i < bits; i++, bitPos++)
+    {
+        if (value & (1UL << i))
+            buf[bitPos / 8] |= (uint8_t)(1 << (bitPos % 8));
+    }
+}
+
+BitReader::BitReader(const uint8_t *buf, size_t len)
+    : buf(buf), len(len), bitPos(0), overflowed(false) {}
+
+uint32_t BitReader::read(uint8_t bits)
+{
+    if (bitPos + bits > len * 8)
+    {
+        overflowed = true;
+        return 0;
+    }
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bits; i++, bitPos++)
+    {
+        if (buf[bitPos / 8] & (1 << (bitPos % 8)))
+            value |= (1UL << i);
+    }
+    return value;
+}
+
+void BitReader::skip(size_t bits)
+{
+    if (bitPos + bits > len * 8)
+        overflowed = true;
+    else
+        bitPos += bits;
+}
+
+uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++)
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+// ===========================================
+// Record
+// ===========================================
+uint32_t coordToFixed(float deg, double offset, uint8_t bits)
+{
+    double v = lround(((double)deg + offset) * WIRE_COORD_SCALE);
+    double max = (double)((1UL << bits) - 1);
+    if (v < 0)
+        v = 0;
+    if (v > max)
+        v = max;
+    return (uint32_t)v;
+}
+
+float fixedToCoord(uint32_t v, double offset)
+{
+    return (float)(v / WIRE_COORD_SCALE - offset);
+}
+
+static int16_t signExtend(uint32_t v, uint8_t bits)
+{
+    if (v & (1UL << (bits - 1)))
+        v |= ~((1UL << bits) - 1);
+    return (int16_t)(int32_t)v;
+}
+
+size_t recordPayloadBits(Topic topic)
+{
+    switch (topic)
+    {
+    case Topic::HEART_RATE:
+    case Topic::SPO2:
+    case Topic::STRESS:
+        return 8;
+    case Topic::GPS:
+    case Topic::SOS:
+        return WIRE_LAT_BITS + WIRE_LON_BITS;
+    case Topic::HEART_RATE_SUMMARY:
+        return 5 * 8;
+    case Topic::GPS_KEYFRAME:
+        return WIRE_LAT_BITS + WIRE_LON_BITS + WIRE_KEY_BITS;
+    case Topic::GPS_DELTA:
+        return WIRE_KEY_BITS + 2 * WIRE_DELTA_BITS;
+    default:
+        return 0;
+    }
+}
+
+bool encodeRecord(BitWriter &w, const DeviceData &data)
+{
+    size_t bits = recordPayloadBits(data.topic);
+    if (bits == 0)
+        return false;
+
+    w.write((uint8_t)data.topic, WIRE_TOPIC_BITS);
+    if (bits == 8)
+    {
+        w.write(data.sensor.value, 8);
+    }
+    else if (data.topic == Topic::HEART_RATE_SUMMARY)
+    {
+        const HRSummary &sum = data.sensor.summary;
+        w.write(sum.min, 8);
+        w.write(sum.max, 8);
+        w.write(sum.mean, 8);
+        w.write(sum.last, 8);
+        w.write(sum.count, 8);
+    }
+    else if (data.topic == Topic::GPS_KEYFRAME)
+    {
+        const LocationKeyframe &kf = data.sensor.keyframe;
+        w.write(coordToFixed(kf.location.lattitude, 90.0, WIRE_LAT_BITS), WIRE_LAT_BITS);
+        w.write(coordToFixed(kf.location.longitude, 180.0, WIRE_LON_BITS), WIRE_LON_BITS);
+        w.write(kf.key, WIRE_KEY_BITS);
+    }
+    else if (data.topic == Topic::GPS_DELTA)
+    {
+        const LocationDelta &d = data.sensor.delta;
+        uint32_t mask = (1UL << WIRE_DELTA_BITS) - 1;
+        w.write(d.key, WIRE_KEY_BITS);
+        w.write((uint32_t)d.dlat & mask, WIRE_DELTA_BITS);
+        w.write((uint32_t)d.dlon & mask, WIRE_DELTA_BITS);
+    }
+    else
+    {
+        w.write(coordToFixed(data.sensor.location.lattitude, 90.0, WIRE_LAT_BITS), WIRE_LAT_BITS);
+        w.write(coordToFixed(data.sensor.location.longitude, 180.0, WIRE_LON_BITS), WIRE_LON_BITS);
+    }
+    return !w.overflow();
+}
+
+bool decodeRecord(BitReader &r, uint8_t device_id, DeviceData &out)
+{
+    Topic topic = (Topic)r.read(WIRE_TOPIC_BITS);
+    size_t bits = recordPayloadBits(topic);
+    if (bits == 0)
+        return false;
+
+    out = DeviceData();
+    out.device_id = device_id;
+    out.topic = topic;
+    if (bits == 8)
+    {
+        out.sensor.value = (uint8_t)r.read(8);
+    }
+    else if (topic == Topic::HEART_RATE_SUMMARY)
+    {
+        HRSummary &sum = out.sensor.summary;
+        sum.min = (uint8_t)r.read(8);
+        sum.max = (uint8_t)r.read(8);
+        sum.mean = (uint8_t)r.read(8);
+        sum.last = (uint8_t)r.read(8);
+        sum.count = (uint8_t)r.read(8);
+    }
+    else if (topic == Topic::GPS_KEYFRAME)
+    {
+        LocationKeyframe &kf = out.sensor.keyframe;
+        kf.location.lattitude = fixedToCoord(r.read(WIRE_LAT_BITS), 90.0);
+        kf.location.longitude = fixedToCoord(r.read(WIRE_LON_BITS), 180.0);
+        kf.key = (uint8_t)r.read(WIRE_KEY_BITS);
+    }
+    else if (topic == Topic::GPS_DELTA)
+    {
+        LocationDelta &d = out.sensor.delta;
+        d.key = (uint8_t)r.read(WIRE_KEY_BITS);
+        d.dlat = signExtend(r.read(WIRE_DELTA_BITS), WIRE_DELTA_BITS);
+        d.dlon = signExtend(r.read(WIRE_DELTA_BITS), WIRE_DELTA_BITS);
+    }
+    else
+    {
+        out.sensor.location.lattitude = fixedToCoord(r.read(WIRE_LAT_BITS), 90.0);
+        out.sensor.location.longitude = fixedToCoord(r.read(WIRE_LON_BITS), 180.0);
+    }
+    return !r.overflow();
+}
+
+// ===========================================
+// Frame
+// ===========================================
+static size_t finishFrame(BitWriter &w, uint8_t *out)
+{
+    if (w.overflow())
+        return 0;
+    size_t len = w.bytes();
+    out[len] = crc8(out, len);
+    return len + WIRE_CRC_LEN;
+}
+
+static void writeHeader(BitWriter &w, uint8_t type, uint8_t device_id, uint8_t seq)
+{
+    w.write(WIRE_VERSION, 4);
+    w.write(type, 4);
+    w.write(device_id, 8);
+    w.write(seq, 8);
+}
+
+bool decodeHeader(const uint8_t *frame, size_t len, FrameHeader &hdr)
+{
+    if (len < WIRE_HEADER_BITS / 8 + WIRE_CRC_LEN)
+        return false;
+
+    size_t body = len - WIRE_CRC_LEN;
+    if (crc8(frame, body) != frame[body])
+    {
+        Serial.println(F("[LoRa] Frame CRC mismatch"));
+        return false;
+    }
+
+    BitReader r(frame, body);
+    hdr.version = (uint8_t)r.read(4);
+    hdr.type = (uint8_t)r.read(4);
+    hdr.device_id = (uint8_t)r.read(8);
+    hdr.seq = (uint8_t)r.read(8);
+    hdr.boot = (hdr.type & FRAME_BOOT) && isDataFrame(hdr.type & ~FRAME_BOOT);
+    if (hdr.boot)
+        hdr.type &= ~FRAME_BOOT;
+    hdr.count = isDataFrame(hdr.type) ? (uint8_t)r.read(WIRE_COUNT_BITS) : 0;
+    hdr.bootId = hdr.boot ? (uint8_t)r.read(WIRE_BOOT_BITS) : 0;
+    if (hdr.version != WIRE_VERSION || r.overflow())
+    {
+        Serial.printf("[LoRa] Unsupported frame v%u type %u\n", hdr.version, hdr.type);
+        return false;
+    }
+    return true;
+}
+
+size_t encodeAck(uint8_t device_id, uint8_t seq, int8_t margin, uint8_t *out, size_t cap)
+{
+    if (cap <= WIRE_CRC_LEN)
+        return 0;
+    BitWriter w(out, cap - WIRE_CRC_LEN);
+    writeHeader(w, FRAME_ACK, device_id, seq);
+    w.write((uint8_t)margin, WIRE_MARGIN_BITS);
+    return finishFrame(w, out);
+}
+
+bool decodeAck(const uint8_t *frame, size_t len, FrameHeader &hdr, int8_t &margin)
+{
+    if (!decodeHeader(frame, len, hdr) || hdr.type != FRAME_ACK)
+        return false;
+
+    BitReader r(frame, len - WIRE_CRC_LEN);
+    r.skip(WIRE_HEADER_BITS);
+    margin = (int8_t)signExtend(r.read(WIRE_MARGIN_BITS), WIRE_MARGIN_BITS);
+    return !r.overflow();
+}
+
+size_t encodeBeacon(const Beacon &beacon, uint8_t *out, size_t cap)
+{
+    if (cap <= WIRE_CRC_LEN || beacon.count > BEACON_MAX_SLOTS)
+        return 0;
+    BitWriter w(out, cap - WIRE_CRC_LEN);
+    writeHeader(w, FRAME_BEACON, 0, beacon.seq);
+    w.write(beacon.slotMs / BEACON_SLOT_UNIT_MS, 8);
+    w.write(beacon.count, 8);
+    for (uint8_t i = 0; i < beacon.count; i++)
+    {
+        w.write(beacon.slots[i], 8);
+        w.write(beacon.sf[i] - LORA_SF_MIN, WIRE_SF_BITS);
+    }
+    return finishFrame(w, out);
+}
+
+bool decodeBeacon(const uint8_t *frame, size_t len, Beacon &out)
+{
+    FrameHeader hdr;
+    if (!decodeHeader(frame, len, hdr) || hdr.type != FRAME_BEACON)
+        return false;
+
+    BitReader r(frame, len - WIRE_CRC_LEN);
+    r.skip(WIRE_HEADER_BITS);
+    out.seq = hdr.seq;
+    out.slotMs = (uint16_t)r.read(8) * BEACON_SLOT_UNIT_MS;
+    out.count = (uint8_t)r.read(8);
+    if (out.count > BEACON_MAX_SLOTS || out.slotMs == 0)
+        return false;
+    for (uint8_t i = 0; i < out.count; i++)
+    {
+        out.slots[i] = (uint8_t)r.read(8);
+        out.sf[i] = LORA_SF_MIN + (uint8_t)r.read(WIRE_SF_BITS);
+    }
+    return !r.overflow();
+}
+
+size_t encodeFrame(uint8_t device_id, uint8_t seq, const DeviceData *records, size_t count, uint8_t *out, size_t cap,
+                   uint8_t type, bool boot, uint8_t bootId)
+{
+    if (cap <= WIRE_CRC_LEN || count > 0xFF || !isDataFrame(type))
+        return 0;
+
+    BitWriter w(out, cap - WIRE_CRC_LEN);
+    writeHeader(w, boot ? type | FRAME_BOOT : type, device_id, seq);
+    w.write((uint8_t)count, WIRE_COUNT_BITS);
+    if (boot)
+        w.write(bootId, WIRE_BOOT_BITS);
+    uint8_t current = device_id;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (records[i].device_id != current)
+        {
+            current = records[i].device_id;
+            w.write(WIRE_WEARER, WIRE_TOPIC_BITS);
+            w.write(current, 8);
+        }
+        if (!encodeRecord(w, records[i]))
+            return 0;
+    }
+    return finishFrame(w, out);
+}
+
+size_t decodeFrame(const uint8_t *frame, size_t len, FrameHeader &hdr, DeviceData *out, size_t maxOut)
+{
+    if (!decodeHeader(frame, len, hdr) || !isDataFrame(hdr.type))
+        return 0;
+
+    BitReader r(frame, len - WIRE_CRC_LEN);
+    r.skip(WIRE_HEADER_BITS + WIRE_COUNT_BITS + (hdr.boot ? WIRE_BOOT_BITS : 0));
+
+    size_t n = 0;
+    uint8_t current = hdr.device_id;
+    while (n < hdr.count && n < maxOut)
+    {
+        // Penanda WIRE_WEARER dibaca tanpa memajukan posisi record
+        BitReader peek = r;
+        if (peek.read(WIRE_TOPIC_BITS) == WIRE_WEARER)
+        {
+            current = (uint8_t)peek.read(8);
+            if (peek.overflow())
+                break;
+            r = peek;
+            continue;
+        }
+        if (!decodeRecord(r, current, out[n]))
+        {
+            Serial.printf("[LoRa] Record %u malformed\n", (unsigned)n);
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+// ===========================================
+// SeqTracker (base)
+// ===========================================
+SeqTracker::SeqTracker() : dupCount(0), gapCount(0)
+{
+    memset(windows, 0, sizeof(windows));
+}
+
+bool SeqTracker::isDuplicate(uint8_t device_id, uint8_t seq, bool boot, uint8_t bootId)
+{
+    Window &w = windows[device_id];
+    // Client reboot: seq mulai lagi, window lama tidak berlaku. Retransmit
+    // frame boot yang sama tetap dicek seperti biasa.
+    if (boot && (!w.bootKnown || w.bootId != bootId))
+    {
+        w.valid = false;
+        w.bootKnown = true;
+        w.bootId = bootId;
+    }
+    if (!w.valid)
+    {
+        w.valid = true;
+        w.last = seq;
+        w.seen = 1;
+        return false;
+    }
+
+    int8_t diff = (int8_t)(seq - w.last);
+    if (diff > 0)
+    {
+        // Frame baru, geser window
+        if (diff > 1)
+            gapCount += diff - 1;
+        w.seen = diff >= 32 ? 0 : w.seen << diff;
+        w.seen |= 1;
+        w.last = seq;
+        return false;
+    }
+
+    uint8_t age = (uint8_t)(-diff);
+    if (age >= 32)
+    {
+        // Terlalu lama (mis. client reboot), anggap awal baru
+        w.last = seq;
+        w.seen = 1;
+        return false;
+    }
+    if (w.seen & (1UL << age))
+    {
+        dupCount++;
+        return true;
+    }
+    // Frame terlambat yang sebelumnya dihitung sebagai gap
+    w.seen |= (1UL << age);
+    if (gapCount)
+        gapCount--;
+    return false;
+}
+
+// ===========================================
+// LoRaBatch (client)
+// ===========================================
+LoRaBatch::LoRaBatch(uint8_t deviceId, size_t maxFrameLen, uint32_t maxAgeMs)
+    : deviceId(deviceId),
+      lastId(deviceId),
+      seq(0),
+      n(0),
+      bits(WIRE_HEADER_BITS + WIRE_COUNT_BITS),
+      maxLen(maxFrameLen > BATCH_MAX_FRAME_LEN ? BATCH_MAX_FRAME_LEN : maxFrameLen),
+      maxAge(maxAgeMs),
+      firstTick(0),
+      hasSOS(false),
+      announceBoot(false),
+      bootId(0) {}
+
+size_t LoRaBatch::headerBits() const
+{
+    return WIRE_HEADER_BITS + WIRE_COUNT_BITS + (announceBoot ? WIRE_BOOT_BITS : 0);
+}
+
+void LoRaBatch::setBootId(uint8_t id)
+{
+    bootId = id;
+    announceBoot = true;
+    if (empty())
+        bits = headerBits();
+}
+
+// Batch yang sedang terkumpul tetap menghitung bit boot_id sampai clear()
+void LoRaBatch::bootAcked()
+{
+    announceBoot = false;
+}
+
+bool LoRaBatch::fits(Topic topic, uint8_t device_id) const
+{
+    size_t payload = recordPayloadBits(topic);
+    size_t total = bits + WIRE_TOPIC_BITS + payload + (device_id != lastId ? WIRE_WEARER_BITS : 0);
+    return payload && n < BATCH_MAX_RECORDS && (total + 7) / 8 + WIRE_CRC_LEN <= maxLen;
+}
+
+bool LoRaBatch::add(const DeviceData &data, uint32_t now)
+{
+    if (!fits(data.topic, data.device_id))
+        return false;
+
+    if (empty())
+        firstTick = now;
+
+    records[n++] = data;
+    bits += WIRE_TOPIC_BITS + recordPayloadBits(data.topic);
+    if (data.device_id != lastId)
+    {
+        bits += WIRE_WEARER_BITS;
+        lastId = data.device_id;
+    }
+    if (data.topic == Topic::SOS)
+        hasSOS = true;
+    return true;
+}
+
+bool LoRaBatch::shouldFlush(uint32_t now) const
+{
+    if (empty())
+        return false;
+    if (hasSOS)
+        return true;
+    // Penuh jika record terbesar (lokasi) sudah tidak muat
+    if (!fits(Topic::GPS))
+        return true;
+    return now - firstTick >= maxAge;
+}
+
+size_t LoRaBatch::encode(uint8_t *out, size_t cap)
+{
+    return encodeFrame(deviceId, seq++, records, n, out, cap, hasSOS ? FRAME_URGENT : FRAME_DATA, announceBoot, bootId);
+}
+
+void LoRaBatch::clear()
+{
+    n = 0;
+    lastId = deviceId;
+    bits = headerBits();
+    hasSOS = false;
+}
@@ -0,0 +1,236 @@
+#pragma once
+#include <Arduino.h>
+#include <data.h>
+
+// ===========================================
+// Wire format LoRa (versi 5)
+// ===========================================
+// Semua field ditulis sebagai bit-stream, LSB dulu, tidak tergantung
+// layout struct dari compiler. Dipakai bersama oleh client dan base.
+//
+// header  : [version:4][frame type:4][device_id:8][seq:8]
+//
+// FRAME_DATA (client -> base): header, [count:8], lalu per record:
+// record  : [topic:4][payload]
+//   WIRE_WEARER            : device_id:8 (bukan record, tidak dihitung di
+//                            count; record berikutnya milik device_id ini.
+//                            Awalnya device_id header. Dipakai gateway
+//                            yang melayani beberapa band.)
+//   HEART_RATE/SPO2/STRESS : value:8
+//   GPS/SOS                : lat:25 lon:26 (fixed-point 1e-5 derajat, offset 90/180)
+//   HEART_RATE_SUMMARY     : min:8 max:8 mean:8 last:8 count:8
+//   GPS_KEYFRAME           : lat:25 lon:26 key:4
+//   GPS_DELTA              : key:4 dlat:14 dlon:14 (signed, relatif ke keyframe)
+//
+// FRAME_BOOT (bit 3 di type FRAME_DATA/FRAME_URGENT): setelah count ada
+//   [boot_id:8]. Client memasang bit ini sampai frame pertama setelah boot
+//   di-ACK. Base mengosongkan window seq device jika boot_id berbeda dari
+//   yang terakhir, supaya seq yang mulai lagi dari 0 tidak dianggap duplikat.
+//
+// FRAME_URGENT: sama dengan FRAME_DATA, berisi SOS. Base menaruhnya di
+//   antrian prioritas dan client mengirim ulang sampai di-ACK.
+//
+// FRAME_ACK (base -> client): header, [margin:8 (signed, dB)]
+//   seq = seq frame yang di-ACK, margin = SNR frame di atas batas
+//   demodulasi SF-nya (untuk ADR daya TX client)
+//
+// FRAME_BEACON (base -> semua): header (device_id = 0, seq = nomor beacon),
+//   [slot_len:8 (x10 ms)][n:8][device_id:8 sf:2 (SF - 7)] x n
+//   Slot 0 setelah beacon adalah slot contention (SOS / client baru),
+//   slot 1..n milik device di slot map, berurutan, dengan SF per slot.
+//
+// trailer : CRC-8 (poly 0x07) dari semua byte sebelumnya
+static constexpr uint8_t WIRE_VERSION = 5;
+static constexpr uint8_t FRAME_DATA = 1;
+static constexpr uint8_t FRAME_ACK = 2;
+static constexpr uint8_t FRAME_BEACON = 3;
+static constexpr uint8_t FRAME_URGENT = 4;
+static constexpr uint8_t FRAME_BOOT = 0x8;
+
+inline bool isDataFrame(uint8_t type)
+{
+    return type == FRAME_DATA || type == FRAME_URGENT;
+}
+
+static constexpr size_t WIRE_HEADER_BITS = 24;
+static constexpr size_t WIRE_COUNT_BITS = 8;
+static constexpr size_t WIRE_BOOT_BITS = 8;
+static constexpr size_t WIRE_TOPIC_BITS = 4;
+static constexpr size_t WIRE_CRC_LEN = 1;
+static constexpr uint8_t WIRE_LAT_BITS = 25;
+static constexpr uint8_t WIRE_LON_BITS = 26;
+static constexpr double WIRE_COORD_SCALE = 1e5;
+static constexpr uint8_t WIRE_KEY_BITS = 4;
+static constexpr uint8_t WIRE_DELTA_BITS = 14;
+static constexpr int32_t WIRE_DELTA_MAX = (1 << (WIRE_DELTA_BITS - 1)) - 1;
+static constexpr uint8_t WIRE_SF_BITS = 2;
+static constexpr uint8_t WIRE_MARGIN_BITS = 8;
+// Nilai topic 4 bit yang tidak dipakai Topic
+static constexpr uint8_t WIRE_WEARER = 0xF;
+static constexpr size_t WIRE_WEARER_BITS = WIRE_TOPIC_BITS + 8;
+
+static constexpr size_t WIRE_MAX_FRAME_LEN = 64;
+static constexpr size_t BATCH_MAX_FRAME_LEN = WIRE_MAX_FRAME_LEN;
+static constexpr size_t BATCH_MAX_RECORDS = 16;
+
+// SF kontrol (beacon, slot contention, ALOHA) sekaligus SF tercepat.
+// Slot device bisa lebih lambat sampai LORA_SF_MAX (batas 2 bit di beacon).
+static constexpr uint8_t LORA_SF_MIN = 7;
+static constexpr uint8_t LORA_SF_MAX = LORA_SF_MIN + (1 << WIRE_SF_BITS) - 1;
+
+// Base menunggu sebentar sebelum ACK supaya client sempat pindah ke RX
+static constexpr uint32_t LORA_ACK_DELAY_MS = 100;
+// Airtime ACK dibulatkan ke atas pada SF kontrol, 2x per kenaikan SF
+static constexpr uint32_t LORA_ACK_AIR_MS = 60;
+inline uint32_t loraAckAirMs(uint8_t sf)
+{
+    return LORA_ACK_AIR_MS << (sf - LORA_SF_MIN);
+}
+inline uint32_t loraAckWindowMs(uint8_t sf)
+{
+    return LORA_ACK_DELAY_MS + 190 + loraAckAirMs(sf);
+}
+
+// 44 slot x 10 bit + header masih muat di WIRE_MAX_FRAME_LEN
+static constexpr size_t BEACON_MAX_SLOTS = 44;
+static constexpr uint16_t BEACON_SLOT_UNIT_MS = 10;
+
+struct Beacon
+{
+    uint8_t seq;
+    uint16_t slotMs;
+    uint8_t count;
+    uint8_t slots[BEACON_MAX_SLOTS];
+    uint8_t sf[BEACON_MAX_SLOTS];
+};
+
+struct FrameHeader
+{
+    uint8_t version;
+    uint8_t type;
+    uint8_t device_id;
+    uint8_t seq;
+    uint8_t count;
+    bool boot;      // FRAME_BOOT, type sudah tanpa bit ini
+    uint8_t bootId;
+};
+
+class BitWriter
+{
+public:
+    BitWriter(uint8_t *buf, size_t cap);
+    void write(uint32_t value, uint8_t bits);
+    size_t bytes() const { return (bitPos + 7) / 8; }
+    bool overflow() const { return overflowed; }
+
+private:
+    uint8_t *buf;
+    size_t cap;
+    size_t bitPos;
+    bool overflowed;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *buf, size_t len);
+    uint32_t read(uint8_t bits);
+    void skip(size_t bits);
+    bool overflow() const { return overflowed; }
+
+private:
+    const uint8_t *buf;
+    size_t len;
+    size_t bitPos;
+    bool overflowed;
+};
+
+uint8_t crc8(const uint8_t *data, size_t len);
+
+// Konversi koordinat <-> fixed-point wire (offset 90 untuk lat, 180 untuk lon)
+uint32_t coordToFixed(float deg, double offset, uint8_t bits);
+float fixedToCoord(uint32_t v, double offset);
+
+// Jumlah bit payload untuk topic, 0 jika topic tidak dikenal
+size_t recordPayloadBits(Topic topic);
+bool encodeRecord(BitWriter &w, const DeviceData &data);
+bool decodeRecord(BitReader &r, uint8_t device_id, DeviceData &out);
+
+// Cek CRC dan versi lalu baca header (count hanya untuk FRAME_DATA)
+bool decodeHeader(const uint8_t *frame, size_t len, FrameHeader &hdr);
+// Encode frame data lengkap (header, record, CRC), return panjang atau 0 jika gagal
+size_t encodeFrame(uint8_t device_id, uint8_t seq, const DeviceData *records, size_t count, uint8_t *out, size_t cap,
+                   uint8_t type = FRAME_DATA, bool boot = false, uint8_t bootId = 0);
+// Decode frame data, return jumlah record valid (0 jika versi/CRC salah)
+size_t decodeFrame(const uint8_t *frame, size_t len, FrameHeader &hdr, DeviceData *out, size_t maxOut);
+size_t encodeAck(uint8_t device_id, uint8_t seq, int8_t margin, uint8_t *out, size_t cap);
+bool decodeAck(const uint8_t *frame, size_t len, FrameHeader &hdr, int8_t &margin);
+size_t encodeBeacon(const Beacon &beacon, uint8_t *out, size_t cap);
+bool decodeBeacon(const uint8_t *frame, size_t len, Beacon &out);
+
+// Base: deteksi duplikat dan gap dari seq per device (window 32 frame)
+class SeqTracker
+{
+public:
+    SeqTracker();
+    // Return true jika frame sudah pernah diterima. Frame FRAME_BOOT
+    // dengan boot_id baru memulai window dari awal.
+    bool isDuplicate(uint8_t device_id, uint8_t seq, bool boot = false, uint8_t bootId = 0);
+    uint32_t duplicates() const { return dupCount; }
+    uint32_t gaps() const { return gapCount; }
+
+private:
+    struct Window
+    {
+        uint32_t seen; // bit i = seq (last - i) sudah diterima
+        uint8_t last;
+        bool valid;
+        bool bootKnown;
+        uint8_t bootId;
+    } windows[256];
+    uint32_t dupCount;
+    uint32_t gapCount;
+};
+
+class LoRaBatch
+{
+public:
+    LoRaBatch(uint8_t deviceId, size_t maxFrameLen = BATCH_MAX_FRAME_LEN, uint32_t maxAgeMs = 10000);
+
+    // Tambah record, return false jika tidak muat (flush dulu). Record
+    // dengan device_id selain deviceId diberi penanda WIRE_WEARER.
+    bool add(const DeviceData &data, uint32_t now);
+    bool fits(Topic topic) const { return fits(topic, lastId); }
+    bool fits(Topic topic, uint8_t device_id) const;
+    // Flush jika penuh, sudah terlalu lama, atau ada SOS di dalam batch
+    bool shouldFlush(uint32_t now) const;
+    // Tulis frame ke buffer dengan seq berikutnya, return panjang frame
+    size_t encode(uint8_t *out, size_t cap);
+    void clear();
+
+    // boot_id acak per boot (panggil sebelum add pertama); frame membawa
+    // FRAME_BOOT sampai bootAcked()
+    void setBootId(uint8_t id);
+    void bootAcked();
+    bool announcingBoot() const { return announceBoot; }
+
+    uint8_t count() const { return n; }
+    bool empty() const { return n == 0; }
+    bool hasSos() const { return hasSOS; }
+
+private:
+    DeviceData records[BATCH_MAX_RECORDS];
+    uint8_t deviceId;
+    uint8_t lastId; // device_id record terakhir
+    uint8_t seq;
+    uint8_t n;
+    size_t bits;
+    size_t maxLen;
+    uint32_t maxAge;
+    uint32_t firstTick;
+    bool hasSOS;
+    bool announceBoot;
+    uint8_t bootId;
+
+    size_t headerBits() const;
+};
@@ -0,0 +1,92 @@
+#include "position_codec.h"
+#include "lora_packet.h"
+
+static const double LAT_OFFSET = 90.0;
+static const double LON_OFFSET = 180.0;
+
+// ===========================================
+// PositionEncoder (client)
+// ===========================================
+PositionEncoder::PositionEncoder(uint8_t keyframeEvery, uint32_t keyframeMaxAgeMs)
+    : keyframeEvery(keyframeEvery),
+      keyframeMaxAge(keyframeMaxAgeMs),
+      hasKeyframe(false),
+      key(0),
+      deltasSinceKeyframe(0),
+      keyframeTick(0),
+      refLat(0),
+      refLon(0) {}
+
+DeviceData PositionEncoder::encode(uint8_t device_id, const Location &loc, uint32_t now)
+{
+    int32_t lat = coordToFixed(loc.lattitude, LAT_OFFSET, WIRE_LAT_BITS);
+    int32_t lon = coordToFixed(loc.longitude, LON_OFFSET, WIRE_LON_BITS);
+    int32_t dlat = lat - refLat;
+    int32_t dlon = lon - refLon;
+
+    DeviceData data = {};
+    data.device_id = device_id;
+
+    bool needKeyframe = !hasKeyframe ||
+                        deltasSinceKeyframe >= keyframeEvery ||
+                        now - keyframeTick >= keyframeMaxAge ||
+                        abs(dlat) > WIRE_DELTA_MAX || abs(dlon) > WIRE_DELTA_MAX;
+    if (needKeyframe)
+    {
+        key = (key + 1) & ((1 << WIRE_KEY_BITS) - 1);
+        hasKeyframe = true;
+        deltasSinceKeyframe = 0;
+        keyframeTick = now;
+        refLat = lat;
+        refLon = lon;
+        data.topic = Topic::GPS_KEYFRAME;
+        data.sensor.keyframe.location = loc;
+        data.sensor.keyframe.key = key;
+        return data;
+    }
+
+    deltasSinceKeyframe++;
+    data.topic = Topic::GPS_DELTA;
+    data.sensor.delta.key = key;
+    data.sensor.delta.dlat = (int16_t)dlat;
+    data.sensor.delta.dlon = (int16_t)dlon;
+    return data;
+}
+
+// ===========================================
+// PositionDecoder (base)
+// ===========================================
+PositionDecoder::PositionDecoder()
+{
+    memset(refs, 0, sizeof(refs));
+}
+
+bool PositionDecoder::resolve(DeviceData &data)
+{
+    Reference &ref = refs[data.device_id];
+    if (data.topic == Topic::GPS_KEYFRAME)
+    {
+        LocationKeyframe kf = data.sensor.keyframe;
+        ref.lat = coordToFixed(kf.location.lattitude, LAT_OFFSET, WIRE_LAT_BITS);
+        ref.lon = coordToFixed(kf.location.longitude, LON_OFFSET, WIRE_LON_BITS);
+        ref.key = kf.key;
+        ref.valid = true;
+        data.topic = Topic::GPS;
+        data.sensor.location = kf.location;
+        return true;
+    }
+    if (data.topic == Topic::GPS_DELTA)
+    {
+        LocationDelta d = data.sensor.delta;
+        if (!ref.valid || ref.key != d.key)
+        {
+            Serial.printf("[GPS] Delta from device %d without keyframe %d, dropped\n", data.device_id, d.key);
+            return false;
+        }
+        data.topic = Topic::GPS;
+        data.sensor.location.lattitude = fixedToCoord(ref.lat + d.dlat, LAT_OFFSET);
+        data.sensor.location.longitude = fixedToCoord(ref.lon + d.dlon, LON_OFFSET);
+        return true;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include <data.h>
+
+// Client: ubah fix GPS menjadi GPS_KEYFRAME atau GPS_DELTA.
+// Keyframe dikirim jika belum ada, delta di luar jangkauan, sudah
+// keyframeEvery delta, atau keyframe lebih tua dari keyframeMaxAgeMs.
+class PositionEncoder
+{
+public:
+    PositionEncoder(uint8_t keyframeEvery = 10, uint32_t keyframeMaxAgeMs = 600000);
+
+    DeviceData encode(uint8_t device_id, const Location &loc, uint32_t now);
+    // Paksa keyframe berikutnya (mis. setelah frame hilang)
+    void reset() { hasKeyframe = false; }
+
+private:
+    uint8_t keyframeEvery;
+    uint32_t keyframeMaxAge;
+    bool hasKeyframe;
+    uint8_t key;
+    uint8_t deltasSinceKeyframe;
+    uint32_t keyframeTick;
+    int32_t refLat, refLon;
+};
+
+// Base: simpan keyframe terakhir per device dan ubah record
+// GPS_KEYFRAME/GPS_DELTA menjadi Topic::GPS dengan lokasi absolut
+class PositionDecoder
+{
+public:
+    PositionDecoder();
+    // Return false jika delta tidak punya keyframe yang cocok (buang)
+    bool resolve(DeviceData &data);
+
+private:
+    struct Reference
+    {
+        int32_t lat, lon;
+        uint8_t key;
+        bool valid;
+    } refs[256];
+};
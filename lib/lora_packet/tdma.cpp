@@ -0,0 +1,156 @@
+#include "tdma.h"
+
+// ===========================================
+// SlotAssigner (base)
+// ===========================================
+SlotAssigner::SlotAssigner(uint16_t slotMs, uint8_t expireFrames)
+    : slotLen(slotMs), expire(expireFrames), seq(0), count(0), limits(ADR_DEFAULT_LIMITS)
+{
+    memset(owner, 0, sizeof(owner));
+    memset(silent, 0, sizeof(silent));
+    memset(sf, LORA_SF_MIN, sizeof(sf));
+    memset(snr, 0, sizeof(snr));
+    memset(slotOf, 0xFF, sizeof(slotOf));
+}
+
+void SlotAssigner::heard(uint8_t device_id, float frameSnr)
+{
+    uint8_t slot = slotOf[device_id];
+    if (slot != 0xFF)
+    {
+        silent[slot] = 0;
+        snr[slot] += (frameSnr - snr[slot]) / (1 << ADR_EWMA_SHIFT);
+        return;
+    }
+    // Slot penuh: device tetap memakai slot contention
+    if (count >= BEACON_MAX_SLOTS)
+        return;
+    owner[count] = device_id;
+    silent[count] = 0;
+    snr[count] = frameSnr;
+    sf[count] = adrInitialSf(frameSnr, limits);
+    slotOf[device_id] = count;
+    count++;
+}
+
+void SlotAssigner::nextBeacon(Beacon &beacon)
+{
+    for (uint8_t i = 0; i < count;)
+    {
+        if (++silent[i] <= expire)
+        {
+            // SNR tidak tergantung SF, jadi EWMA tetap berlaku setelah SF berubah
+            sf[i] = adrNextSf(sf[i], snr[i], limits);
+            i++;
+            continue;
+        }
+        // Lepas slot: pindahkan slot terakhir ke sini supaya hanya satu
+        // device yang slotnya berubah
+        slotOf[owner[i]] = 0xFF;
+        count--;
+        if (i < count)
+        {
+            owner[i] = owner[count];
+            silent[i] = silent[count];
+            sf[i] = sf[count];
+            snr[i] = snr[count];
+            slotOf[owner[i]] = i;
+        }
+    }
+
+    beacon.seq = seq++;
+    beacon.slotMs = slotLen;
+    beacon.count = count;
+    memcpy(beacon.slots, owner, count);
+    memcpy(beacon.sf, sf, count);
+}
+
+// ===========================================
+// SlotClock (client)
+// ===========================================
+SlotClock::SlotClock()
+    : beaconTick(0), superframe(0), slotLen(0), myOffset(0), mySlot(0),
+      mySf(LORA_SF_MIN), beaconSeq(0), valid(false) {}
+
+void SlotClock::onBeacon(const Beacon &beacon, uint32_t rxTick, uint8_t device_id, uint16_t preamble)
+{
+    beaconTick = rxTick;
+    beaconSeq = beacon.seq;
+    slotLen = beacon.slotMs;
+    superframe = tdmaSuperframeMs(beacon, preamble);
+    mySlot = 0;
+    mySf = LORA_SF_MIN;
+    uint32_t offset = TDMA_BEACON_GUARD_MS + beacon.slotMs;
+    for (uint8_t i = 0; i < beacon.count; i++)
+    {
+        if (beacon.slots[i] == device_id)
+        {
+            mySlot = i + 1;
+            mySf = beacon.sf[i];
+            myOffset = offset;
+            break;
+        }
+        offset += tdmaSlotMs(beacon.slotMs, beacon.sf[i]);
+    }
+    valid = true;
+}
+
+bool SlotClock::synced(uint32_t now) const
+{
+    return valid && now - beaconTick < superframe * TDMA_SYNC_LOSS_FRAMES;
+}
+
+void SlotClock::windowFor(uint8_t slot, uint32_t offset, uint32_t length, uint8_t sf,
+                          uint32_t airMs, uint32_t now, SlotWindow &out) const
+{
+    out.slot = slot;
+    out.sf = sf;
+    out.contention = slot == 0;
+
+    // Airtime berlipat 2x per SF di atas SF kontrol
+    uint32_t needed = (airMs << (sf - LORA_SF_MIN)) + tdmaAckReserveMs(sf);
+    // Frame lebih panjang dari slot: mulai tepat di awal slot
+    uint32_t usable = length > needed ? length - needed : 0;
+
+    uint32_t base = beaconTick + offset;
+    if ((int32_t)(now - base) < 0)
+    {
+        out.start = base;
+        out.length = usable;
+        out.frameSeq = beaconSeq;
+        return;
+    }
+    // Superframe berikutnya diasumsikan sama sampai beacon baru datang
+    uint32_t elapsed = now - base;
+    uint32_t frames = elapsed / superframe;
+    uint32_t pos = elapsed % superframe;
+    if (pos <= usable)
+    {
+        out.start = now;
+        out.length = usable - pos;
+    }
+    else
+    {
+        out.start = now - pos + superframe;
+        out.length = usable;
+        frames++;
+    }
+    out.frameSeq = (uint8_t)(beaconSeq + frames);
+}
+
+bool SlotClock::nextWindow(uint32_t now, bool urgent, uint32_t airMs, SlotWindow &out) const
+{
+    if (!synced(now))
+        return false;
+
+    if (mySlot)
+        windowFor(mySlot, myOffset, tdmaSlotMs(slotLen, mySf), mySf, airMs, now, out);
+    if (!mySlot || urgent)
+    {
+        SlotWindow shared;
+        windowFor(0, TDMA_BEACON_GUARD_MS, slotLen, LORA_SF_MIN, airMs, now, shared);
+        if (!mySlot || (int32_t)(shared.start - out.start) < 0)
+            out = shared;
+    }
+    return true;
+}
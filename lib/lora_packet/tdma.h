@@ -0,0 +1,138 @@
+#pragma once
+#include <Arduino.h>
+#include "lora_packet.h"
+#include "adr.h"
+#include "channel_plan.h"
+
+// ===========================================
+// TDMA dengan beacon
+// ===========================================
+// Base mengirim beacon berisi slot map lalu superframe:
+//
+//   [beacon][guard][slot 0: contention][slot 1: map[0]]...[slot n: map[n-1]]
+//
+// Beacon berikutnya dikirim setelah slot terakhir, jadi satu superframe
+// (akhir beacon ke akhir beacon berikutnya) ikut memuat airtime beacon.
+// Client yang belum
+// punya slot (atau membawa SOS) memakai slot contention; base memberi
+// slot di beacon berikutnya setelah mendengar frame dari device itu.
+// Tanpa beacon client kembali ke ALOHA biasa.
+//
+// Slot device memakai SF dari ADR; panjang slot berlipat 2x per SF di
+// atas SF kontrol, mengikuti airtime.
+static constexpr uint32_t TDMA_BEACON_GUARD_MS = 50;
+
+// Sisa slot untuk ACK dari base (delay + airtime ACK)
+inline uint32_t tdmaAckReserveMs(uint8_t sf)
+{
+    return LORA_ACK_DELAY_MS + loraAckAirMs(sf);
+}
+// Client dianggap kehilangan sinkron setelah sekian superframe tanpa beacon
+static constexpr uint8_t TDMA_SYNC_LOSS_FRAMES = 3;
+// Base melepas slot device yang diam sekian superframe
+static constexpr uint8_t TDMA_EXPIRE_FRAMES = 8;
+
+// slotMs = panjang slot pada SF kontrol
+inline uint32_t tdmaSlotMs(uint16_t slotMs, uint8_t sf)
+{
+    return (uint32_t)slotMs << (sf - LORA_SF_MIN);
+}
+
+// Airtime frame len byte di SF kontrol (BW 125 kHz, CR 4/5, header
+// eksplisit, CRC), rumus time-on-air SX126x, dibulatkan ke atas
+inline uint32_t tdmaBeaconAirMs(size_t len, uint16_t preamble = LORA_PREAMBLE_LEN)
+{
+    const uint32_t symUs = (1UL << LORA_SF_MIN) * 1000 / 125;
+    int32_t bits = 8 * (int32_t)len - 4 * LORA_SF_MIN + 28 + 16;
+    uint32_t blocks = bits > 0 ? (bits + 4 * LORA_SF_MIN - 1) / (4 * LORA_SF_MIN) : 0;
+    // preamble + 4.25 simbol sync, 8 simbol header, 5 simbol per blok (CR 4/5)
+    uint32_t quarterSyms = (preamble + 8 + blocks * 5) * 4 + 17;
+    return (quarterSyms * symUs / 4 + 999) / 1000;
+}
+
+// preamble = ChannelPlan::preambleLength(), sama di base dan client
+inline uint32_t tdmaSuperframeMs(const Beacon &beacon, uint16_t preamble = LORA_PREAMBLE_LEN)
+{
+    uint8_t buf[WIRE_MAX_FRAME_LEN];
+    size_t len = encodeBeacon(beacon, buf, sizeof(buf));
+    uint32_t total = tdmaBeaconAirMs(len, preamble) + TDMA_BEACON_GUARD_MS + beacon.slotMs;
+    for (uint8_t i = 0; i < beacon.count; i++)
+        total += tdmaSlotMs(beacon.slotMs, beacon.sf[i]);
+    return total;
+}
+
+// Base: pembagian slot dan SF per slot. device_id -> slot lewat index 256 byte.
+class SlotAssigner
+{
+public:
+    SlotAssigner(uint16_t slotMs = 400, uint8_t expireFrames = TDMA_EXPIRE_FRAMES);
+
+    // Dari RX task untuk setiap frame data valid
+    void heard(uint8_t device_id, float snr);
+    // Susun beacon berikutnya, lepas slot device yang sudah lama diam
+    // dan sesuaikan SF tiap slot
+    void nextBeacon(Beacon &beacon);
+
+    void setSlotMs(uint16_t ms) { slotLen = ms; }
+    void setLimits(const AdrLimits &l) { limits = l; }
+    uint16_t slotMs() const { return slotLen; }
+    uint8_t assigned() const { return count; }
+
+private:
+    uint16_t slotLen;
+    uint8_t expire;
+    uint8_t seq;
+    uint8_t count;
+    AdrLimits limits;
+    uint8_t owner[BEACON_MAX_SLOTS];
+    uint8_t silent[BEACON_MAX_SLOTS]; // superframe sejak terakhir terdengar
+    uint8_t sf[BEACON_MAX_SLOTS];
+    float snr[BEACON_MAX_SLOTS];      // EWMA
+    uint8_t slotOf[256];
+};
+
+// Jendela TX di satu slot: frame harus mulai di [start, start + length]
+// supaya TX dan ACK selesai dalam slot
+struct SlotWindow
+{
+    uint32_t start;
+    uint32_t length;
+    uint8_t slot;       // 0 = contention
+    uint8_t frameSeq;   // nomor superframe (seq beacon), untuk channel slot
+    uint8_t sf;
+    bool contention;
+};
+
+// Client: jadwal slot dari beacon terakhir
+class SlotClock
+{
+public:
+    SlotClock();
+
+    // rxTick = millis() saat beacon selesai diterima (dari ISR DIO1),
+    // preamble = ChannelPlan::preambleLength() untuk airtime beacon
+    void onBeacon(const Beacon &beacon, uint32_t rxTick, uint8_t device_id,
+                  uint16_t preamble = LORA_PREAMBLE_LEN);
+    bool synced(uint32_t now) const;
+    bool assigned() const { return mySlot != 0; }
+
+    uint8_t slotSf() const { return mySf; }
+
+    // Jendela TX berikutnya untuk frame dengan airtime airMs (pada SF
+    // kontrol). Slot contention dipakai jika belum punya slot atau frame
+    // urgent (SOS). Return false jika belum sinkron.
+    bool nextWindow(uint32_t now, bool urgent, uint32_t airMs, SlotWindow &out) const;
+
+private:
+    uint32_t beaconTick;
+    uint32_t superframe;
+    uint16_t slotLen;
+    uint32_t myOffset; // awal slot sendiri dari akhir beacon
+    uint8_t mySlot;    // 0 = tidak punya slot
+    uint8_t mySf;
+    uint8_t beaconSeq;
+    bool valid;
+
+    void windowFor(uint8_t slot, uint32_t offset, uint32_t length, uint8_t sf,
+                   uint32_t airMs, uint32_t now, SlotWindow &out) const;
+};
@@ -1,5 +1,8 @@
 #include "mqtt_manager.h"
 
+static constexpr uint32_t MQTT_CONNECT_BACKOFF_MIN_MS = 1000;
+static constexpr uint32_t MQTT_CONNECT_BACKOFF_MAX_MS = 30000;
+
 MqttManager::MqttManager(const char *wifiSsid,
                          const char *wifiPass,
                          const char *mqttServer,
@@ -12,8 +15,15 @@ MqttManager::MqttManager(const char *wifiSsid,
       user(mqttUser),
       pass(mqttPass),
       port(mqttPort),
-      mqttClient(wifiClient)
+      mqttClient(wifiClient),
+      connectBackoff(MQTT_CONNECT_BACKOFF_MIN_MS)
+{
+}
+
+void MqttManager::setBufferSize(uint16_t size)
 {
+    if (!mqttClient.setBufferSize(size))
+        Serial.printf("[MQTT] Failed to allocate %u byte buffer\n", size);
 }
 
 void MqttManager::begin()
@@ -22,47 +32,110 @@ void MqttManager::begin()
     connectWiFi();
 
     mqttClient.setServer(server, port);
-    lastReconnectAttempt = 0;
+    startConnect();
+}
+
+void MqttManager::connectTask(void *param)
+{
+    MqttManager *self = (MqttManager *)param;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->connState = self->connectMQTT() ? ConnState::OPENED : ConnState::FAILED;
+    }
+}
+
+bool MqttManager::startConnect()
+{
+    // Task dibuat saat pertama dipakai, scheduler belum jalan di konstruktor global
+    if (!connectHandle &&
+        xTaskCreatePinnedToCore(connectTask, "MQTT connect", 4096, this, 1, &connectHandle, 0) != pdPASS)
+    {
+        connectHandle = nullptr;
+        return false;
+    }
+    Serial.printf("[MQTT] Connecting to %s:%u ...\n", server, port);
+    connState = ConnState::CONNECTING;
+    xTaskNotifyGive(connectHandle);
+    return true;
 }
 
 void MqttManager::loop()
 {
-    if (!mqttClient.connected())
+    ConnState state = connState;
+    switch (state)
     {
-        unsigned long now = millis();
-        if (now - lastReconnectAttempt > RECONNECT_INTERVAL)
+    case ConnState::CONNECTING:
+        return;
+    case ConnState::OPENED:
+        Serial.println("[MQTT] Connected");
+        connectBackoff = MQTT_CONNECT_BACKOFF_MIN_MS;
+        connState = ConnState::CONNECTED;
+        // fallthrough
+    case ConnState::CONNECTED:
+        if (mqttClient.connected())
         {
-            lastReconnectAttempt = now;
-            if (connectMQTT())
-                lastReconnectAttempt = 0;
+            mqttClient.loop();
+            return;
         }
+        Serial.printf("[MQTT] Connection lost rc=%d\n", mqttClient.state());
+        break;
+    case ConnState::FAILED:
+        Serial.printf("[MQTT] Failed rc=%d, retry in %lu ms\n", mqttClient.state(), connectBackoff);
+        connState = ConnState::BACKOFF;
+        connectRetryAt = millis() + connectBackoff;
+        connectBackoff = min(connectBackoff * 2, MQTT_CONNECT_BACKOFF_MAX_MS);
+        return;
+    case ConnState::BACKOFF:
+        if ((int32_t)(millis() - connectRetryAt) < 0)
+            return;
+        break;
+    case ConnState::IDLE:
+        break;
     }
-    else
-    {
-        mqttClient.loop();
-    }
+    startConnect();
 }
 
 bool MqttManager::isConnected() const
 {
-    return const_cast<PubSubClient &>(mqttClient).connected();
+    // Selama task connect berjalan mqttClient tidak boleh disentuh
+    return connState == ConnState::CONNECTED && const_cast<PubSubClient &>(mqttClient).connected();
 }
 
 bool MqttManager::publish(const char *topic, const String &payload)
 {
-    if (!mqttClient.connected())
+    return publish(topic, payload.c_str());
+}
+
+bool MqttManager::publish(const char *topic, const char *payload)
+{
+    if (!isConnected())
         return false;
 
-    bool ok = mqttClient.publish(topic, payload.c_str());
+    bool ok = mqttClient.publish(topic, payload);
     if (ok)
-        Serial.printf("[MQTT] Published → %s: %s\n", topic, payload.c_str());
+        Serial.printf("[MQTT] Published → %s: %s\n", topic, payload);
     else
         Serial.printf("[MQTT] Publish failed → %s\n", topic);
     return ok;
 }
 
+bool MqttManager::publish(const char *topic, const uint8_t *payload, size_t len)
+{
+    if (!isConnected())
+        return false;
+
+    bool ok = mqttClient.publish(topic, payload, len);
+    if (!ok)
+        Serial.printf("[MQTT] Publish failed → %s (%u bytes)\n", topic, (unsigned)len);
+    return ok;
+}
+
 void MqttManager::connectWiFi()
 {
+    // WiFi mungkin sudah tersambung dari setupTime()
+    if (WiFi.status() == WL_CONNECTED)
+        return;
     WiFi.mode(WIFI_STA);
     WiFi.begin(ssid, password);
     Serial.printf("[WiFi] Connecting to %s", ssid);
@@ -85,25 +158,11 @@ void MqttManager::connectWiFi()
     }
 }
 
+// Dijalankan di task connect; hasilnya dilaporkan loop()
 bool MqttManager::connectMQTT()
 {
-    Serial.printf("[MQTT] Connecting to %s:%u ...\n", server, port);
     String clientId = "esp32-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-
-    bool connected = false;
     if (user && pass)
-        connected = mqttClient.connect(clientId.c_str(), user, pass);
-    else
-        connected = mqttClient.connect(clientId.c_str());
-
-    if (connected)
-    {
-        Serial.println("[MQTT] Connected");
-        return true;
-    }
-    else
-    {
-        Serial.printf("[MQTT] Failed rc=%d\n", mqttClient.state());
-        return false;
-    }
+        return mqttClient.connect(clientId.c_str(), user, pass);
+    return mqttClient.connect(clientId.c_str());
 }
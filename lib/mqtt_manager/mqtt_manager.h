@@ -2,7 +2,14 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <atomic>
 
+// Koneksi ke broker (TCP connect + CONNECT/CONNACK, bisa beberapa detik)
+// dibuka oleh task sendiri supaya loop() tidak tertahan. loop() hanya
+// menjalankan mqttClient.loop() dan memeriksa koneksi; jika putus, task
+// diminta connect lagi. Setelah connect gagal ada jeda backoff
+// (MQTT_CONNECT_BACKOFF_MIN_MS, dobel tiap gagal sampai
+// MQTT_CONNECT_BACKOFF_MAX_MS). Selama task berjalan, publish() false.
 class MqttManager
 {
 public:
@@ -13,12 +20,27 @@ public:
                 const char *mqttUser = nullptr,
                 const char *mqttPass = nullptr);
 
+    // Panggil sebelum begin(); PubSubClient default hanya 256 byte per paket
+    void setBufferSize(uint16_t size);
     void begin();
     void loop();
     bool isConnected() const;
+    bool connecting() const { return connState == ConnState::CONNECTING; }
     bool publish(const char *topic, const String &payload);
+    bool publish(const char *topic, const char *payload);
+    bool publish(const char *topic, const uint8_t *payload, size_t len);
 
 private:
+    enum class ConnState : uint8_t
+    {
+        IDLE,
+        CONNECTING, // mqttClient dipakai task connect, loop() tidak menyentuhnya
+        OPENED,     // connect berhasil, belum dilihat loop()
+        CONNECTED,
+        FAILED,     // connect gagal, belum dilaporkan loop()
+        BACKOFF     // menunggu connectRetryAt sebelum connect lagi
+    };
+
     const char *ssid;
     const char *password;
     const char *server;
@@ -29,9 +51,13 @@ private:
     WiFiClient wifiClient;
     PubSubClient mqttClient;
 
-    unsigned long lastReconnectAttempt{0};
-    static constexpr unsigned long RECONNECT_INTERVAL = 5000;
+    std::atomic<ConnState> connState{ConnState::IDLE};
+    TaskHandle_t connectHandle{nullptr};
+    uint32_t connectRetryAt{0};
+    uint32_t connectBackoff;
 
+    static void connectTask(void *param);
+    bool startConnect();
     void connectWiFi();
     bool connectMQTT();
 };
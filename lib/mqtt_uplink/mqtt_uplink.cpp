@@ -0,0 +1,185 @@
+#ifdef DEVICE_MODE_BASE
+#include "mqtt_uplink.h"
+#include <payload_writer.h>
+
+static constexpr uint32_t TOKEN = 1000;
+
+MqttUplink::MqttUplink(MqttManager &mqtt, const char *topic, const char *sosTopic,
+                       size_t batchMax, uint32_t flushMs,
+                       uint32_t ratePerSec, uint32_t burst, uint32_t retryMs)
+    : mqtt(mqtt),
+      topic(topic),
+      sosTopic(sosTopic),
+      batchMax(batchMax == 0 ? 1 : (batchMax > MQTT_BATCH_LIMIT ? MQTT_BATCH_LIMIT : batchMax)),
+      flushMs(flushMs),
+      ratePerSec(ratePerSec ? ratePerSec : 1),
+      burst(burst ? burst : 1),
+      retryMs(retryMs),
+      tokens(burst * TOKEN),
+      lastRefill(0),
+      oldestTick(0),
+      retryAt(0),
+      backPressure(false),
+      published(0),
+      publishes(0),
+      failed(0),
+      dropped(0),
+      bytes(0),
+      sosRetryAt(0) {}
+
+bool MqttUplink::push(const DeviceData &data, uint32_t timestamp, uint32_t rxTick)
+{
+    UplinkItem item;
+    item.data = data;
+    item.timestamp = timestamp;
+
+    if (data.topic == Topic::SOS)
+    {
+        if (sosQueue.push({item, rxTick}))
+            return true;
+        Serial.println("[MQTT] SOS queue full, SOS dropped");
+        dropped++;
+        return false;
+    }
+
+    if (queue.empty())
+        oldestTick = millis();
+    bool ok = queue.push(item);
+    if (!ok)
+    {
+        Serial.println("[MQTT] Uplink queue full, reading dropped");
+        dropped++;
+    }
+    updatePressure();
+    return ok;
+}
+
+void MqttUplink::refill(uint32_t now)
+{
+    // ratePerSec token per 1000 ms = ratePerSec milli-token per ms
+    uint32_t elapsed = now - lastRefill;
+    lastRefill = now;
+    uint32_t cap = burst * TOKEN;
+    if (elapsed >= cap / ratePerSec)
+        tokens = cap;
+    else
+        tokens = min(cap, tokens + elapsed * ratePerSec);
+}
+
+void MqttUplink::loop(uint32_t now)
+{
+    mqtt.loop();
+    refill(now);
+    if (!mqtt.isConnected())
+        return;
+
+    // SOS dulu, dengan retry sendiri
+    SosItem *sos;
+    while ((int32_t)(now - sosRetryAt) >= 0 && (sos = sosQueue.peek()))
+    {
+        if (!publishSos(*sos))
+        {
+            Serial.println("[MQTT] SOS publish failed, retrying");
+            failed++;
+            sosRetryAt = now + MQTT_SOS_RETRY_MS;
+            break;
+        }
+        sosQueue.discard();
+    }
+
+    if ((int32_t)(now - retryAt) < 0)
+        return;
+    while (!queue.empty())
+    {
+        if (queue.size() < batchMax && now - oldestTick < flushMs)
+            break;
+        if (tokens < TOKEN)
+            break;
+        tokens -= TOKEN;
+        if (!publishBatch(now))
+        {
+            failed++;
+            retryAt = now + retryMs;
+            break;
+        }
+    }
+    updatePressure();
+}
+
+bool MqttUplink::publishSos(const SosItem &sos)
+{
+    PackWriter w(payload, sizeof(payload));
+    w.map(2).str("v").uint(1).str("r").array(1);
+    if (!writeReadingPack(w, sos.item) || !mqtt.publish(sosTopic, w.data(), w.length()))
+        return false;
+    uint32_t ms = millis() - sos.rxTick;
+    sosLatency.record(ms, SOS_UPLINK_BUDGET_MS);
+    Serial.printf("[MQTT] SOS published, %lu ms after RX%s\n", ms, ms > SOS_UPLINK_BUDGET_MS ? " over budget" : "");
+    published++;
+    publishes++;
+    bytes += w.length();
+    return true;
+}
+
+bool MqttUplink::publishBatch(uint32_t now)
+{
+    PackWriter w(payload, sizeof(payload));
+    size_t count = 0;
+    w.map(2).str("v").uint(1).str("r");
+    size_t header = w.beginArray16();
+    while (count < batchMax)
+    {
+        UplinkItem *item = queue.at(count);
+        if (!item)
+            break;
+        size_t mark = w.length();
+        if (!writeReadingPack(w, *item))
+        {
+            w.truncate(mark);
+            break;
+        }
+        count++;
+    }
+    w.patchArray16(header, count);
+
+    if (!count || !mqtt.publish(topic, w.data(), w.length()))
+        return false;
+    for (size_t i = 0; i < count; i++)
+        queue.discard();
+    oldestTick = now;
+    published += count;
+    publishes++;
+    bytes += w.length();
+    return true;
+}
+
+void MqttUplink::updatePressure()
+{
+    size_t n = queue.size();
+    if (!backPressure && n >= queue.capacity() * 3 / 4)
+    {
+        backPressure = true;
+        Serial.printf("[MQTT] Uplink congested (%u queued), pausing LoRa drain\n", (unsigned)n);
+    }
+    else if (backPressure && n <= queue.capacity() / 2)
+    {
+        backPressure = false;
+        Serial.printf("[MQTT] Uplink recovered (%u queued)\n", (unsigned)n);
+    }
+}
+
+MqttUplinkStats MqttUplink::stats() const
+{
+    MqttUplinkStats s;
+    s.queued = queue.size();
+    s.published = published;
+    s.publishes = publishes;
+    s.failed = failed;
+    s.dropped = dropped;
+    s.bytes = bytes;
+    s.congested = congested();
+    s.sosQueued = sosQueue.size();
+    s.sos = sosLatency;
+    return s;
+}
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#ifdef DEVICE_MODE_BASE
+#include <Arduino.h>
+#include <data.h>
+#include <ring_buffer.h>
+#include <mqtt_manager.h>
+
+static constexpr size_t MQTT_QUEUE_LEN = 257; // 256 pembacaan
+static constexpr size_t MQTT_BATCH_LIMIT = 64;
+// Pembacaan terbesar (ringkasan HR) sekitar 20 byte MessagePack
+static constexpr size_t MQTT_PAYLOAD_LEN = 16 + MQTT_BATCH_LIMIT * 20;
+// Paket MQTT = header + topic + payload, dipakai untuk setBufferSize()
+static constexpr uint16_t MQTT_PACKET_LEN = MQTT_PAYLOAD_LEN + 128;
+static constexpr size_t MQTT_SOS_QUEUE_LEN = 9; // 8 SOS
+static constexpr uint32_t MQTT_SOS_RETRY_MS = 500;
+
+struct MqttUplinkStats
+{
+    uint32_t queued;
+    uint32_t published; // pembacaan yang sudah di-publish
+    uint32_t publishes; // jumlah publish
+    uint32_t failed;    // publish gagal (akan dicoba lagi)
+    uint32_t dropped;   // antrian penuh
+    uint32_t bytes;     // total payload
+    bool congested;
+    uint32_t sosQueued;
+    SosLatency sos;     // frame diterima -> publish SOS
+};
+
+// Uplink MQTT: pembacaan dari semua device dikumpulkan dan di-publish
+// sebagai satu payload MessagePack per batch lewat koneksi persisten:
+//
+//   {"v": 1, "r": [reading, reading, ...]}   (lihat writeReadingPack)
+//
+// Publish dibatasi token bucket (ratePerSec, burst). SOS punya antrian
+// sendiri, di-publish satu per satu ke sosTopic sebelum batch apa pun,
+// tanpa token, dan dicoba lagi tiap MQTT_SOS_RETRY_MS sampai berhasil.
+// SOS tidak ikut dihitung untuk back-pressure.
+//
+// congested() menjadi true saat antrian melewati 3/4 kapasitas dan baru
+// turun lagi di bawah 1/2. Selama itu loop() base berhenti menguras
+// frame LoRa, sehingga antrian RX penuh dan frame tidak di-ACK (client
+// mengirim ulang nanti). Selama MqttManager membuka koneksi ke broker
+// congested() juga true, publish belum mungkin.
+class MqttUplink
+{
+public:
+    MqttUplink(MqttManager &mqtt, const char *topic, const char *sosTopic,
+               size_t batchMax = 32, uint32_t flushMs = 1000,
+               uint32_t ratePerSec = 4, uint32_t burst = 8, uint32_t retryMs = 2000);
+
+    // rxTick = millis() saat frame LoRa diterima, untuk latensi SOS
+    bool push(const DeviceData &data, uint32_t timestamp, uint32_t rxTick);
+    // Panggil dari loop(): jaga koneksi, publish batch jika token tersedia
+    void loop(uint32_t now);
+    bool congested() const { return backPressure || mqtt.connecting(); }
+    MqttUplinkStats stats() const;
+
+private:
+    MqttManager &mqtt;
+    const char *topic;
+    const char *sosTopic;
+    size_t batchMax;
+    uint32_t flushMs;
+    uint32_t ratePerSec;
+    uint32_t burst;
+    uint32_t retryMs;
+
+    RingBuffer<UplinkItem, MQTT_QUEUE_LEN> queue;
+    uint8_t payload[MQTT_PAYLOAD_LEN];
+    uint32_t tokens; // token x 1000
+    uint32_t lastRefill;
+    uint32_t oldestTick;
+    uint32_t retryAt;
+    bool backPressure;
+    uint32_t published, publishes, failed, dropped, bytes;
+
+    RingBuffer<SosItem, MQTT_SOS_QUEUE_LEN> sosQueue;
+    uint32_t sosRetryAt;
+    SosLatency sosLatency;
+
+    void refill(uint32_t now);
+    bool publishBatch(uint32_t now);
+    bool publishSos(const SosItem &sos);
+    void updatePressure();
+};
+#endif
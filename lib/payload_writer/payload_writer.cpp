@@ -0,0 +1,256 @@
+#include "payload_writer.h"
+#include <string.h>
+
+BufferWriter::BufferWriter(char *buf, size_t cap)
+    : buf(buf), cap(cap), len(0), overflowed(cap == 0)
+{
+    if (cap)
+        buf[0] = '\0';
+}
+
+BufferWriter &BufferWriter::chr(char c)
+{
+    if (len + 1 >= cap)
+    {
+        overflowed = true;
+        return *this;
+    }
+    buf[len++] = c;
+    buf[len] = '\0';
+    return *this;
+}
+
+BufferWriter &BufferWriter::str(const char *s)
+{
+    while (*s)
+        chr(*s++);
+    return *this;
+}
+
+BufferWriter &BufferWriter::u32(uint32_t v)
+{
+    char tmp[10];
+    uint8_t n = 0;
+    do
+    {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    } while (v);
+    while (n)
+        chr(tmp[--n]);
+    return *this;
+}
+
+BufferWriter &BufferWriter::i32(int32_t v)
+{
+    if (v < 0)
+    {
+        chr('-');
+        return u32((uint32_t)(-(int64_t)v));
+    }
+    return u32((uint32_t)v);
+}
+
+BufferWriter &BufferWriter::fixed(float v, uint8_t decimals)
+{
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++)
+        scale *= 10;
+
+    double d = v;
+    if (d < 0)
+    {
+        chr('-');
+        d = -d;
+    }
+    uint64_t scaled = (uint64_t)(d * scale + 0.5);
+    u32((uint32_t)(scaled / scale));
+    if (!decimals)
+        return *this;
+
+    chr('.');
+    uint32_t frac = (uint32_t)(scaled % scale);
+    for (uint32_t div = scale / 10; div; div /= 10)
+    {
+        chr('0' + (frac / div) % 10);
+    }
+    return *this;
+}
+
+// ===========================================
+// Payload
+// ===========================================
+size_t writeReadingJson(BufferWriter &w, const UplinkItem &item)
+{
+    const DeviceData &data = item.data;
+    w.str("{\"device_id\":").u32(data.device_id);
+    w.str(",\"timestamp\":").u32(item.timestamp);
+    switch (data.topic)
+    {
+    case Topic::GPS:
+    case Topic::SOS:
+        w.str(",\"lattitude\":").fixed(data.sensor.location.lattitude, 6);
+        w.str(",\"longitude\":").fixed(data.sensor.location.longitude, 6);
+        break;
+    case Topic::HEART_RATE:
+        w.str(",\"heart_rate\":").u32(data.sensor.value);
+        break;
+    case Topic::HEART_RATE_SUMMARY:
+        w.str(",\"heart_rate\":").u32(data.sensor.summary.mean);
+        w.str(",\"heart_rate_min\":").u32(data.sensor.summary.min);
+        w.str(",\"heart_rate_max\":").u32(data.sensor.summary.max);
+        w.str(",\"heart_rate_last\":").u32(data.sensor.summary.last);
+        w.str(",\"sample_count\":").u32(data.sensor.summary.count);
+        break;
+    case Topic::SPO2:
+        w.str(",\"spo2\":").u32(data.sensor.value);
+        break;
+    case Topic::STRESS:
+        w.str(",\"stress_level\":").u32(data.sensor.value);
+        break;
+    default:
+        break;
+    }
+    w.chr('}');
+    return w.overflow() ? 0 : w.length();
+}
+
+size_t writeReadingJson(char *buf, size_t cap, const UplinkItem &item)
+{
+    BufferWriter w(buf, cap);
+    return writeReadingJson(w, item);
+}
+
+// ===========================================
+// MessagePack
+// ===========================================
+PackWriter::PackWriter(uint8_t *buf, size_t cap)
+    : buf(buf), cap(cap), len(0), overflowed(false) {}
+
+void PackWriter::put(uint8_t b)
+{
+    if (len >= cap)
+    {
+        overflowed = true;
+        return;
+    }
+    buf[len++] = b;
+}
+
+void PackWriter::putBE(uint32_t v, uint8_t bytes)
+{
+    while (bytes--)
+        put((uint8_t)(v >> (bytes * 8)));
+}
+
+PackWriter &PackWriter::uint(uint32_t v)
+{
+    if (v < 0x80)
+        put((uint8_t)v);
+    else if (v <= 0xFF)
+    {
+        put(0xCC);
+        put((uint8_t)v);
+    }
+    else if (v <= 0xFFFF)
+    {
+        put(0xCD);
+        putBE(v, 2);
+    }
+    else
+    {
+        put(0xCE);
+        putBE(v, 4);
+    }
+    return *this;
+}
+
+PackWriter &PackWriter::float32(float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put(0xCA);
+    putBE(bits, 4);
+    return *this;
+}
+
+PackWriter &PackWriter::str(const char *s)
+{
+    size_t n = strlen(s);
+    if (n < 32)
+        put(0xA0 | n);
+    else
+    {
+        put(0xD9);
+        put((uint8_t)n);
+    }
+    while (*s)
+        put((uint8_t)*s++);
+    return *this;
+}
+
+PackWriter &PackWriter::array(uint16_t n)
+{
+    if (n < 16)
+        put(0x90 | n);
+    else
+    {
+        put(0xDC);
+        putBE(n, 2);
+    }
+    return *this;
+}
+
+PackWriter &PackWriter::map(uint8_t n)
+{
+    put(0x80 | (n & 0x0F));
+    return *this;
+}
+
+size_t PackWriter::beginArray16()
+{
+    size_t at = len;
+    put(0xDC);
+    putBE(0, 2);
+    return at;
+}
+
+void PackWriter::patchArray16(size_t at, uint16_t n)
+{
+    if (at + 3 > len)
+        return;
+    buf[at + 1] = (uint8_t)(n >> 8);
+    buf[at + 2] = (uint8_t)n;
+}
+
+void PackWriter::truncate(size_t at)
+{
+    if (at < len)
+        len = at;
+    overflowed = false;
+}
+
+size_t writeReadingPack(PackWriter &w, const UplinkItem &item)
+{
+    const DeviceData &data = item.data;
+    switch (data.topic)
+    {
+    case Topic::GPS:
+    case Topic::SOS:
+        w.array(5).uint(data.device_id).uint((uint8_t)data.topic).uint(item.timestamp);
+        w.float32(data.sensor.location.lattitude).float32(data.sensor.location.longitude);
+        break;
+    case Topic::HEART_RATE_SUMMARY:
+    {
+        const HRSummary &sum = data.sensor.summary;
+        w.array(8).uint(data.device_id).uint((uint8_t)data.topic).uint(item.timestamp);
+        w.uint(sum.min).uint(sum.max).uint(sum.mean).uint(sum.last).uint(sum.count);
+        break;
+    }
+    default:
+        w.array(4).uint(data.device_id).uint((uint8_t)data.topic).uint(item.timestamp);
+        w.uint(data.sensor.value);
+        break;
+    }
+    return w.overflow() ? 0 : w.length();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <data.h>
+
+// Penulis teks ke buffer milik pemanggil, tanpa alokasi heap.
+// Jika buffer tidak cukup, overflow() true dan isi terpotong (tetap
+// diakhiri '\0').
+class BufferWriter
+{
+public:
+    BufferWriter(char *buf, size_t cap);
+
+    BufferWriter &str(const char *s);
+    BufferWriter &chr(char c);
+    BufferWriter &u32(uint32_t v);
+    BufferWriter &i32(int32_t v);
+    // Angka desimal fixed-point, tanpa printf float (newlib dtoa memakai heap)
+    BufferWriter &fixed(float v, uint8_t decimals);
+
+    const char *c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool overflow() const { return overflowed; }
+
+private:
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflowed;
+};
+
+// Objek JSON satu pembacaan untuk API, return panjang atau 0 jika tidak muat
+size_t writeReadingJson(BufferWriter &w, const UplinkItem &item);
+size_t writeReadingJson(char *buf, size_t cap, const UplinkItem &item);
+
+// Penulis MessagePack ke buffer milik pemanggil, subset yang dipakai
+// uplink saja (uint, float32, str, array, map kecil).
+class PackWriter
+{
+public:
+    PackWriter(uint8_t *buf, size_t cap);
+
+    PackWriter &uint(uint32_t v);
+    PackWriter &float32(float v);
+    PackWriter &str(const char *s);
+    PackWriter &array(uint16_t n);
+    PackWriter &map(uint8_t n);
+    // Array yang jumlahnya baru diketahui setelah isi ditulis: tulis
+    // header array16 kosong, lalu isi jumlahnya dengan patchArray16()
+    size_t beginArray16();
+    void patchArray16(size_t at, uint16_t n);
+    // Buang semua byte setelah posisi at (elemen yang tidak muat)
+    void truncate(size_t at);
+
+    const uint8_t *data() const { return buf; }
+    size_t length() const { return len; }
+    bool overflow() const { return overflowed; }
+
+private:
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflowed;
+
+    void put(uint8_t b);
+    void putBE(uint32_t v, uint8_t bytes);
+};
+
+// Satu pembacaan sebagai array MessagePack:
+//   vital    : [device_id, topic, timestamp, value]
+//   GPS/SOS  : [device_id, topic, timestamp, lat(f32), lon(f32)]
+//   ringkasan: [device_id, topic, timestamp, min, max, mean, last, count]
+// Return panjang total writer, 0 jika tidak muat
+size_t writeReadingPack(PackWriter &w, const UplinkItem &item);
@@ -0,0 +1,77 @@
+#include "report_policy.h"
+#include <math.h>
+
+ReportPolicy::ReportPolicy() : suppressedCount(0)
+{
+    memset(states, 0, sizeof(states));
+}
+
+void ReportPolicy::setRule(Topic topic, float deadband, uint32_t maxSilenceMs)
+{
+    size_t idx = (size_t)topic;
+    if (idx >= TOPIC_SLOTS)
+        return;
+    states[idx].rule.deadband = deadband;
+    states[idx].rule.maxSilenceMs = maxSilenceMs;
+    states[idx].enabled = true;
+    states[idx].sent = false;
+}
+
+float ReportPolicy::distanceMeters(const Location &a, const Location &b)
+{
+    // Haversine, cukup akurat untuk jarak pendek
+    const double R = 6371000.0;
+    double lat1 = radians(a.lattitude), lat2 = radians(b.lattitude);
+    double dLat = lat2 - lat1;
+    double dLon = radians((double)b.longitude - a.longitude);
+    double h = sin(dLat / 2) * sin(dLat / 2) + cos(lat1) * cos(lat2) * sin(dLon / 2) * sin(dLon / 2);
+    return (float)(2 * R * asin(sqrt(h)));
+}
+
+bool ReportPolicy::shouldReport(const DeviceData &data, uint32_t now)
+{
+    size_t idx = (size_t)data.topic;
+    // SOS tidak pernah ditahan
+    if (data.topic == Topic::SOS || idx >= TOPIC_SLOTS || !states[idx].enabled)
+        return true;
+
+    State &st = states[idx];
+    bool isLocation = data.topic == Topic::GPS;
+    bool isSummary = data.topic == Topic::HEART_RATE_SUMMARY;
+    float value = 0, vmin = 0, vmax = 0;
+    if (isSummary)
+    {
+        value = data.sensor.summary.mean;
+        vmin = data.sensor.summary.min;
+        vmax = data.sensor.summary.max;
+    }
+    else if (!isLocation)
+        value = data.sensor.value;
+
+    bool report = !st.sent;
+    if (!report && st.rule.maxSilenceMs && now - st.lastTick >= st.rule.maxSilenceMs)
+        report = true;
+    if (!report)
+    {
+        float delta = isLocation ? distanceMeters(st.lastLocation, data.sensor.location)
+                                 : fabsf(value - st.lastValue);
+        // Lonjakan min/max tetap dikirim walau mean tidak berubah
+        if (isSummary)
+            delta = fmaxf(delta, fmaxf(fabsf(vmin - st.lastMin), fabsf(vmax - st.lastMax)));
+        report = delta >= st.rule.deadband;
+    }
+
+    if (!report)
+    {
+        suppressedCount++;
+        return false;
+    }
+    st.sent = true;
+    st.lastTick = now;
+    st.lastValue = value;
+    st.lastMin = vmin;
+    st.lastMax = vmax;
+    if (isLocation)
+        st.lastLocation = data.sensor.location;
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+#include <data.h>
+
+// Aturan pelaporan per topic: kirim hanya jika nilai berubah minimal
+// deadband, atau jika sudah maxSilenceMs tanpa laporan (heartbeat).
+// Untuk GPS deadband dalam meter, untuk ringkasan HR berlaku untuk mean,
+// min dan max. Topic tanpa aturan selalu dikirim.
+struct ReportRule
+{
+    float deadband;
+    uint32_t maxSilenceMs;
+};
+
+class ReportPolicy
+{
+public:
+    ReportPolicy();
+
+    void setRule(Topic topic, float deadband, uint32_t maxSilenceMs);
+    // Cek sekaligus catat sebagai terkirim jika return true
+    bool shouldReport(const DeviceData &data, uint32_t now);
+    uint32_t suppressed() const { return suppressedCount; }
+
+    static float distanceMeters(const Location &a, const Location &b);
+
+private:
+    static constexpr size_t TOPIC_SLOTS = 16;
+    struct State
+    {
+        ReportRule rule;
+        bool enabled;
+        bool sent;
+        uint32_t lastTick;
+        float lastValue;
+        float lastMin, lastMax; // ringkasan HR
+        Location lastLocation;
+    } states[TOPIC_SLOTS];
+    uint32_t suppressedCount;
+};
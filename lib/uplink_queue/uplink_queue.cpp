@@ -0,0 +1,358 @@
+#ifdef DEVICE_MODE_BASE
+#include "uplink_queue.h"
+#include <payload_writer.h>
+
+UplinkQueue::UplinkQueue(HttpPipeline &http, HttpPipeline &sosHttp, const char *dataPath, const char *sosPath,
+                         size_t batchMax, uint32_t flushMs, uint32_t retryMs)
+    : http(http),
+      sosHttp(sosHttp),
+      dataPath(dataPath),
+      sosPath(sosPath),
+      batchMax(batchMax == 0 ? 1 : (batchMax > UPLINK_BATCH_LIMIT ? UPLINK_BATCH_LIMIT : batchMax)),
+      flushMs(flushMs),
+      retryMs(retryMs),
+      journal(nullptr),
+      replayMs(0),
+      inFlightHead(0),
+      inFlightBatches(0),
+      inFlightItems(0),
+      replaySeq(0),
+      oldestTick(0),
+      retryAt(0),
+      lastReplay(0),
+      posted(0),
+      requests(0),
+      failed(0),
+      dropped(0),
+      backPressure(false),
+      sosInFlight(false),
+      sosRetryAt(0),
+      sosFailed(0) {}
+
+void UplinkQueue::attachJournal(Journal *j, uint32_t replayIntervalMs)
+{
+    journal = j;
+    replayMs = replayIntervalMs;
+    if (replaying())
+        Serial.printf("[HTTP] %lu readings pending in journal\n", (unsigned long)journal->pending());
+}
+
+bool UplinkQueue::push(const DeviceData &data, uint32_t timestamp, uint32_t rxTick)
+{
+    UplinkItem item;
+    item.data = data;
+    item.timestamp = timestamp;
+
+    if (data.topic == Topic::SOS)
+    {
+        if (sosQueue.push({item, rxTick}))
+            return true;
+        Serial.println("[HTTP] SOS queue full, SOS dropped");
+        dropped++;
+        return false;
+    }
+
+    // Selama journal belum habis, pembacaan baru antre di belakangnya
+    if (replaying() && journal->append(item))
+        return true;
+
+    if (queue.empty())
+        oldestTick = millis();
+    bool ok = queue.push(item);
+    if (!ok && journal)
+    {
+        // Antrian penuh: pindahkan antrian ke journal dulu (tertua dulu)
+        // supaya pembacaan baru tetap di belakangnya
+        spillToJournal();
+        ok = queue.empty() ? journal->append(item) : queue.push(item);
+    }
+    updatePressure();
+    if (ok)
+        return true;
+    Serial.println("[HTTP] Uplink queue full, reading dropped");
+    dropped++;
+    return false;
+}
+
+void UplinkQueue::loop(uint32_t now)
+{
+    // Append/consume journal sejak loop sebelumnya disimpan sekaligus
+    if (journal)
+        journal->sync();
+
+    HttpResult result;
+    // Jalur SOS dulu, tidak terpengaruh retry/journal jalur data
+    while (sosHttp.poll(result))
+        handleSosResponse(result, now);
+    flushSos(now);
+
+    while (http.poll(result))
+        handleResponse(result, now);
+    updatePressure();
+    if ((int32_t)(now - retryAt) < 0)
+        return;
+    // Isi pipeline selama ada batch yang siap
+    while (flush(now))
+        ;
+}
+
+bool UplinkQueue::itemAt(bool fromJournal, size_t i, UplinkItem &item)
+{
+    if (fromJournal)
+        return journal->read(i, item);
+    UplinkItem *p = queue.at(i);
+    if (!p)
+        return false;
+    item = *p;
+    return true;
+}
+
+bool UplinkQueue::flush(uint32_t now)
+{
+    if (!http.canSend())
+        return false;
+    bool fromJournal = replaying();
+    // Pipeline hanya berisi batch dari satu sumber supaya offset tetap benar
+    if (inFlightBatches && inFlight[inFlightHead].fromJournal != fromJournal)
+        return false;
+
+    size_t start = inFlightItems;
+    UplinkItem item;
+    if (fromJournal)
+    {
+        // Journal penuh menggeser tail selagi batch in-flight, jadi offset
+        // dihitung dari seq setelah batch terakhir, bukan jumlah item
+        uint32_t tail = journal->tail();
+        start = inFlightBatches && replaySeq > tail ? replaySeq - tail : 0;
+        // Replay dibatasi supaya API tidak dibanjiri setelah pulih
+        if (now - lastReplay < replayMs || journal->pending() <= start)
+            return false;
+        if (!itemAt(true, start, item))
+        {
+            // Record journal rusak, lewati
+            if (!inFlightBatches)
+                journal->consume(1);
+            return false;
+        }
+    }
+    else
+    {
+        if (!itemAt(false, start, item))
+            return false;
+        if (queue.size() - start < batchMax && now - oldestTick < flushMs)
+            return false;
+    }
+
+    size_t count = 0;
+    BufferWriter w(body, sizeof(body));
+    char one[UPLINK_READING_MAX];
+    w.chr('[');
+    while (count < batchMax && itemAt(fromJournal, start + count, item))
+    {
+        size_t len = writeReadingJson(one, sizeof(one), item);
+        // ',' + objek + ']' harus muat
+        if (!len || w.length() + len + 2 >= sizeof(body))
+            break;
+        if (count)
+            w.chr(',');
+        w.str(one);
+        count++;
+    }
+    w.chr(']');
+
+    if (!http.post(dataPath, "application/json", (const uint8_t *)body, w.length()))
+    {
+        // Koneksi lama masih punya request tertunda (tunggu hasilnya di
+        // poll()), atau koneksi baru sedang dibuka
+        if (http.inFlight() || http.connecting())
+            return false;
+        Serial.println("[HTTP] Failed to send request");
+        failed++;
+        retryAt = now + retryMs;
+        if (!fromJournal)
+            spillToJournal();
+        return false;
+    }
+
+    uint32_t lastSeq = 0;
+    if (fromJournal)
+    {
+        lastSeq = journal->tail() + start + count - 1;
+        replaySeq = lastSeq + 1;
+    }
+    inFlight[(inFlightHead + inFlightBatches) % HTTP_PIPELINE_MAX] = {(uint8_t)count, fromJournal, lastSeq};
+    inFlightBatches++;
+    inFlightItems += count;
+    requests++;
+    if (fromJournal)
+        lastReplay = now;
+    Serial.printf("[HTTP] Posting %u readings to %s%s (%u in flight)\n", (unsigned)count, dataPath,
+                  fromJournal ? " (replay)" : "", (unsigned)inFlightBatches);
+    return true;
+}
+
+void UplinkQueue::handleResponse(const HttpResult &result, uint32_t now)
+{
+    if (!inFlightBatches)
+        return;
+    Batch batch = inFlight[inFlightHead];
+    inFlightHead = (inFlightHead + 1) % HTTP_PIPELINE_MAX;
+    inFlightBatches--;
+
+    if (result.status == 200 || result.status == 201)
+    {
+        Serial.printf("[HTTP] Response: %d (%lu ms)\n", result.status, result.latencyMs);
+        inFlightItems -= batch.count;
+        if (batch.fromJournal)
+        {
+            journal->consumeThrough(batch.lastSeq);
+        }
+        else
+        {
+            for (size_t i = 0; i < batch.count; i++)
+                queue.discard();
+            oldestTick = now;
+        }
+        posted += batch.count;
+        return;
+    }
+
+    // Response lain di pipeline diabaikan, semua batch in-flight dikirim
+    // ulang setelah retryMs
+    Serial.printf("[HTTP] Error: status code %d\n", result.status);
+    failed++;
+    retryAt = now + retryMs;
+    http.reset();
+    inFlightHead = 0;
+    inFlightBatches = 0;
+    inFlightItems = 0;
+    if (!batch.fromJournal)
+        spillToJournal();
+}
+
+void UplinkQueue::flushSos(uint32_t now)
+{
+    if (sosInFlight || (int32_t)(now - sosRetryAt) < 0)
+        return;
+    SosItem *sos = sosQueue.peek();
+    if (!sos || !sosHttp.canSend())
+        return;
+
+    size_t len = writeReadingJson(sosBody, sizeof(sosBody), sos->item);
+    if (!len || !sosHttp.post(sosPath, "application/json", (const uint8_t *)sosBody, len))
+    {
+        // Koneksi baru sedang dibuka di task, kirim begitu siap
+        if (len && sosHttp.connecting())
+            return;
+        Serial.println("[HTTP] SOS request failed, retrying");
+        sosFailed++;
+        sosRetryAt = now + UPLINK_SOS_RETRY_MS;
+        return;
+    }
+    sosInFlight = true;
+    Serial.printf("[HTTP] Posting SOS from device %u (%lu ms after RX)\n", sos->item.data.device_id, millis() - sos->rxTick);
+}
+
+void UplinkQueue::handleSosResponse(const HttpResult &result, uint32_t now)
+{
+    sosInFlight = false;
+    SosItem *sos = sosQueue.peek();
+    if (!sos)
+        return;
+    if (result.status != 200 && result.status != 201)
+    {
+        Serial.printf("[HTTP] SOS error: status code %d, retrying\n", result.status);
+        sosFailed++;
+        sosRetryAt = now + UPLINK_SOS_RETRY_MS;
+        sosHttp.reset();
+        return;
+    }
+    uint32_t ms = millis() - sos->rxTick;
+    sosLatency.record(ms, SOS_UPLINK_BUDGET_MS);
+    Serial.printf("[HTTP] SOS posted, %lu ms after RX (HTTP %lu ms)%s\n", ms, result.latencyMs,
+                  ms > SOS_UPLINK_BUDGET_MS ? " over budget" : "");
+    sosQueue.discard();
+    posted++;
+}
+
+void UplinkQueue::spillToJournal()
+{
+    if (!journal)
+        return;
+    size_t moved = 0;
+    // Batch RAM yang masih in-flight ikut dipindah dan menjadi batch replay,
+    // supaya urutan journal tetap urutan diterima. Journal pasti kosong
+    // selama ada batch RAM in-flight (pipeline hanya berisi satu sumber).
+    if (inFlightBatches && !inFlight[inFlightHead].fromJournal && journal->empty())
+    {
+        // Disalin dulu, antrian baru dibuang setelah semua tersalin. Jika
+        // journal gagal di tengah, salinan hanya menjadi duplikat.
+        uint32_t last[HTTP_PIPELINE_MAX];
+        uint32_t seq = journal->tail() - 1;
+        size_t i = 0;
+        for (size_t b = 0; b < inFlightBatches; b++)
+        {
+            const Batch &batch = inFlight[(inFlightHead + b) % HTTP_PIPELINE_MAX];
+            for (size_t k = 0; k < batch.count; k++, i++)
+            {
+                if (!journal->append(*queue.at(i), &seq))
+                    return;
+            }
+            last[b] = seq;
+        }
+        for (size_t b = 0; b < inFlightBatches; b++)
+        {
+            Batch &batch = inFlight[(inFlightHead + b) % HTTP_PIPELINE_MAX];
+            batch.fromJournal = true;
+            batch.lastSeq = last[b];
+        }
+        replaySeq = seq + 1;
+        for (; moved < inFlightItems; moved++)
+            queue.discard();
+    }
+
+    UplinkItem *item;
+    while ((item = queue.peek()) && journal->append(*item))
+    {
+        queue.discard();
+        moved++;
+    }
+    if (moved)
+        Serial.printf("[HTTP] %u readings moved to journal\n", (unsigned)moved);
+}
+
+void UplinkQueue::updatePressure()
+{
+    // Dengan journal, antrian yang penuh tumpah ke flash, jadi yang dijaga
+    // isi journal supaya record tertua tidak tertimpa
+    size_t n = journal ? journal->pending() : queue.size();
+    size_t cap = journal ? journal->capacity() : queue.capacity();
+    if (!backPressure && n + UPLINK_CONGESTED_HEADROOM >= cap)
+    {
+        backPressure = true;
+        Serial.printf("[HTTP] Uplink congested (%u queued), pausing LoRa drain\n", (unsigned)n);
+    }
+    else if (backPressure && n <= cap / 2)
+    {
+        backPressure = false;
+        Serial.printf("[HTTP] Uplink recovered (%u queued)\n", (unsigned)n);
+    }
+}
+
+UplinkStats UplinkQueue::stats() const
+{
+    UplinkStats s;
+    s.queued = queue.size();
+    s.inFlight = inFlightBatches;
+    s.posted = posted;
+    s.requests = requests;
+    s.failed = failed;
+    s.dropped = dropped;
+    s.journaled = journal ? journal->pending() : 0;
+    s.congested = backPressure;
+    s.sosQueued = sosQueue.size();
+    s.sosFailed = sosFailed;
+    s.sos = sosLatency;
+    return s;
+}
+#endif
@@ -0,0 +1,118 @@
+#pragma once
+#ifdef DEVICE_MODE_BASE
+#include <Arduino.h>
+#include <data.h>
+#include <ring_buffer.h>
+#include <journal.h>
+#include <lora_packet.h>
+#include <http_pipeline.h>
+
+static constexpr size_t UPLINK_QUEUE_LEN = 65; // 64 pembacaan
+static constexpr size_t UPLINK_READING_MAX = 192;
+static constexpr size_t UPLINK_BATCH_LIMIT = 16;
+// Body POST ditulis ke buffer tetap ini, tanpa String/JsonDocument
+static constexpr size_t UPLINK_BODY_LEN = UPLINK_BATCH_LIMIT * UPLINK_READING_MAX + 2;
+static constexpr size_t UPLINK_SOS_QUEUE_LEN = 9; // 8 SOS
+static constexpr uint32_t UPLINK_SOS_RETRY_MS = 500;
+// congested() aktif saat sisa antrian kurang dari satu frame LoRa penuh
+// dan baru lepas lagi setelah antrian turun ke setengah kapasitas
+static constexpr size_t UPLINK_CONGESTED_HEADROOM = BATCH_MAX_RECORDS;
+
+struct UplinkStats
+{
+    uint32_t queued;
+    uint32_t inFlight; // POST yang menunggu response
+    uint32_t posted;   // pembacaan yang sudah diterima API
+    uint32_t requests; // jumlah POST
+    uint32_t failed;   // POST gagal (akan dicoba lagi)
+    uint32_t dropped;  // antrian penuh
+    uint32_t journaled; // pembacaan yang menunggu di journal flash
+    bool congested;
+    uint32_t sosQueued;
+    uint32_t sosFailed;
+    SosLatency sos;     // frame diterima -> POST SOS selesai
+};
+
+// Antrian uplink HTTP: pembacaan dikumpulkan lalu dikirim sebagai satu
+// JSON array per POST lewat HttpPipeline (satu koneksi keep-alive).
+// Beberapa batch bisa in-flight sekaligus; pembacaan baru dibuang dari
+// antrian setelah response 2xx, jadi batch berikutnya diambil mulai dari
+// offset inFlightItems.
+//
+// Jika satu POST gagal, koneksi direset dan semua batch in-flight dikirim
+// ulang setelah retryMs. Batch setelahnya mungkin sudah diproses server,
+// jadi API bisa menerima duplikat (at-least-once).
+//
+// Jika journal dipasang, POST yang gagal memindahkan antrian RAM ke
+// journal. Selama journal belum kosong semua pembacaan baru ikut masuk
+// journal (urutan tetap), dan journal di-replay dengan jeda replayMs.
+//
+// SOS tidak lewat antrian di atas: antrian sendiri di RAM, koneksi
+// sendiri (sosHttp) supaya tidak menunggu response batch di pipeline,
+// satu POST per SOS, dan dicoba lagi tiap UPLINK_SOS_RETRY_MS sampai
+// berhasil. SOS tidak pernah masuk journal.
+class UplinkQueue
+{
+public:
+    UplinkQueue(HttpPipeline &http, HttpPipeline &sosHttp, const char *dataPath, const char *sosPath,
+                size_t batchMax = 16, uint32_t flushMs = 2000, uint32_t retryMs = 5000);
+
+    void attachJournal(Journal *journal, uint32_t replayMs = 1000);
+    // rxTick = millis() saat frame LoRa diterima, untuk latensi SOS
+    bool push(const DeviceData &data, uint32_t timestamp, uint32_t rxTick);
+    // Panggil dari loop(): ambil response lalu kirim batch selama pipeline
+    // belum penuh dan batch sudah penuh/cukup lama
+    void loop(uint32_t now);
+    // Antrian RAM hampir penuh dan tidak ada journal untuk menampung
+    bool congested() const { return backPressure; }
+    UplinkStats stats() const;
+
+private:
+    struct Batch
+    {
+        uint8_t count;
+        bool fromJournal;
+        uint32_t lastSeq; // seq journal terakhir di batch replay
+    };
+
+    HttpPipeline &http;
+    HttpPipeline &sosHttp;
+    const char *dataPath;
+    const char *sosPath;
+    size_t batchMax;
+    uint32_t flushMs;
+    uint32_t retryMs;
+    Journal *journal;
+    uint32_t replayMs;
+
+    RingBuffer<UplinkItem, UPLINK_QUEUE_LEN> queue;
+    char body[UPLINK_BODY_LEN];
+    // Batch in-flight, urutan sama dengan request di pipeline
+    Batch inFlight[HTTP_PIPELINE_MAX];
+    size_t inFlightHead;
+    size_t inFlightBatches;
+    size_t inFlightItems;
+    uint32_t replaySeq; // seq journal berikutnya yang belum in-flight
+    uint32_t oldestTick;
+    uint32_t retryAt;
+    uint32_t lastReplay;
+    uint32_t posted, requests, failed, dropped;
+    bool backPressure;
+
+    RingBuffer<SosItem, UPLINK_SOS_QUEUE_LEN> sosQueue;
+    char sosBody[UPLINK_READING_MAX];
+    bool sosInFlight;
+    uint32_t sosRetryAt;
+    uint32_t sosFailed;
+    SosLatency sosLatency;
+
+    bool replaying() const { return journal && !journal->empty(); }
+    bool itemAt(bool fromJournal, size_t i, UplinkItem &item);
+    bool flush(uint32_t now);
+    void handleResponse(const HttpResult &result, uint32_t now);
+    void flushSos(uint32_t now);
+    void handleSosResponse(const HttpResult &result, uint32_t now);
+    void spillToJournal();
+    void updatePressure();
+};
+#endif
@@ -0,0 +1,53 @@
+#include "vitals_aggregator.h"
+
+WindowAggregator::WindowAggregator(uint32_t windowMs, uint8_t maxSamples)
+    : windowMs(windowMs),
+      maxSamples(maxSamples ? maxSamples : 1)
+{
+    reset();
+}
+
+void WindowAggregator::reset()
+{
+    windowStart = 0;
+    sum = 0;
+    n = 0;
+    minValue = 0xFF;
+    maxValue = 0;
+    lastValue = 0;
+}
+
+void WindowAggregator::add(uint8_t value, uint32_t timestamp)
+{
+    if (n == 0)
+        windowStart = timestamp;
+    if (value < minValue)
+        minValue = value;
+    if (value > maxValue)
+        maxValue = value;
+    lastValue = value;
+    sum += value;
+    n++;
+}
+
+bool WindowAggregator::ready(uint32_t now) const
+{
+    if (n == 0)
+        return false;
+    return n >= maxSamples || now - windowStart >= windowMs;
+}
+
+HRSummary WindowAggregator::take()
+{
+    HRSummary summary = {};
+    if (n)
+    {
+        summary.min = minValue;
+        summary.max = maxValue;
+        summary.mean = (uint8_t)((sum + n / 2) / n);
+        summary.last = lastValue;
+        summary.count = n;
+    }
+    reset();
+    return summary;
+}
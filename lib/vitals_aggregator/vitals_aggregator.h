@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+#include <data.h>
+
+// Agregasi sampel dalam satu window waktu menjadi satu HRSummary
+// (min/max/mean/last + jumlah sampel). Window dimulai dari sampel pertama.
+class WindowAggregator
+{
+public:
+    explicit WindowAggregator(uint32_t windowMs, uint8_t maxSamples = 255);
+
+    void add(uint8_t value, uint32_t timestamp);
+    // Window selesai: durasi habis atau jumlah sampel maksimum tercapai
+    bool ready(uint32_t now) const;
+    // Ambil ringkasan window saat ini lalu mulai window baru
+    HRSummary take();
+    void reset();
+
+    uint8_t count() const { return n; }
+    bool empty() const { return n == 0; }
+
+private:
+    uint32_t windowMs;
+    uint8_t maxSamples;
+    uint32_t windowStart;
+    uint32_t sum;
+    uint8_t n;
+    uint8_t minValue, maxValue, lastValue;
+};
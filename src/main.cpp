@@ -5,54 +5,97 @@
 #include "lora_manager.h"
 #include "mqtt_manager.h"
 #include "data.h"
+#include "position_codec.h"
 
 #ifdef DEVICE_MODE_CLIENT
+#include "vitals_aggregator.h"
+#include "report_policy.h"
 #elif defined(DEVICE_MODE_BASE)
-#include <AsyncHTTPRequest_Generic.h>   
-#include "ArduinoJson.h"
+#ifdef UPLINK_MQTT
+#include "mqtt_uplink.h"
+#else
+#include "http_pipeline.h"
+#include "uplink_queue.h"
+#include "journal.h"
+#endif
 #endif
 
 #define LED_PIN GPIO_NUM_37
 
 #ifdef DEVICE_MODE_CLIENT
 #include "ble_manager.h"
-// BLE target Aolon
+// ID gateway: identitas link LoRa (slot TDMA, ADR, seq), GPS dan SOS.
+// Pembacaan band dikirim dengan device_id pemakai masing-masing.
 const int DEVICE_ID = 11;
-const char targetAddress[] PROGMEM = "f8:fd:e8:84:37:89";
 #define SOS_PIN GPIO_NUM_42 
 #define AOLON_SERVICE_UUID "0000feea-0000-1000-8000-00805f9b34fb"
 #define AOLON_WRITE_UUID "0000fee2-0000-1000-8000-00805f9b34fb"
 #define AOLON_NOTIFY_UUID "0000fee3-0000-1000-8000-00805f9b34fb"
 
 #define GPS_BAUD 9600
+#define GPS_RX_BUFFER 1024
+static const uint32_t GPS_IDLE_WAKE_MS = 5000;
 HardwareSerial GPSSerial(2);
 TinyGPSPlus gps;
 
 
-static const uint32_t BLE_RECONNECT_MS = 5000;
 static const uint32_t TRIGGER_INTERVAL_MS = 300000;          // 5 menit
 static const uint32_t INTERVAL_BETWEEN_SPO2_STRESS = 120000; // 2 menit
-static const uint32_t GPS_INTERVAL_MS = 60000;               // 1 menit
+// Laju GPS adaptif: cepat saat bergerak, heartbeat lambat saat diam
+static const uint32_t GPS_MOVING_INTERVAL_MS = 10000;        // 10 detik
+static const uint32_t GPS_STATIONARY_INTERVAL_MS = 300000;   // 5 menit
+static const float GPS_MOVING_KMPH = 2.0;
+static const float GPS_COURSE_CHANGE_DEG = 30.0;
+static const uint8_t GPS_KEYFRAME_EVERY = 10;                // keyframe absolut tiap 10 posisi
+static const uint32_t BATCH_MAX_AGE_MS = 10000;              // flush batch paling lambat 10 detik
+static const uint32_t HR_WINDOW_MS = 60000;                  // ringkasan HR per 1 menit, 0 = kirim tiap sampel
+// Deadband pelaporan, nilai yang berubah kurang dari ini tidak dikirim
+static const float HR_DEADBAND_BPM = 3;
+static const float SPO2_DEADBAND_PCT = 1;
+static const float STRESS_DEADBAND = 5;
+static const float GPS_DEADBAND_M = 25;
+static const uint32_t REPORT_MAX_SILENCE_MS = 600000;        // heartbeat paling lambat 10 menit
 #define BUTTON_LONG_TIME 2000
 #define BUTTON_DEBUNCE_TIME 50
 bool is_pressed = false;
 bool streesTriggerPending = true;
+// Fix GPS terakhir, hanya dipakai oleh loop()
 GPSData gpsData;
+QueueHandle_t gpsMailbox;
+TaskHandle_t gpsTaskHandle = nullptr;
 
 struct Timers
 {
-    uint32_t bleReconnect{0};
     uint32_t sendTick{0};
     uint32_t status{0};
     uint32_t triggerTick{0};
     uint32_t interval_spo_stress{0};
-    uint32_t gps_tick{0};
     uint32_t debounce_tick{0};
     uint32_t hold_tick{UINT32_MAX};
 } timers;
 
-// BLE & Sensor instance
-BLEManager ble(targetAddress, 6);
+// Band Aolon yang dilayani gateway ini: {alamat, device_id pemakai, scan (detik)}
+// Maksimal BLE_MAX_WEARERS. Reconnect semua band dijalankan task BLE
+// connect dengan jeda per band, loop() hanya memakai isReady().
+BLEManager wearers[] = {
+    {"f8:fd:e8:84:37:89", 11, 3},
+};
+static const size_t WEARER_COUNT = sizeof(wearers) / sizeof(wearers[0]);
+// State pelaporan per pemakai
+struct WearerState
+{
+    // Agregasi sampel heart rate per window
+    WindowAggregator hrWindow{HR_WINDOW_MS};
+    ReportPolicy policy;
+} wearerState[WEARER_COUNT];
+// Batch pembacaan semua pemakai sebelum dikirim lewat LoRa
+LoRaBatch batch(DEVICE_ID, BATCH_MAX_FRAME_LEN, BATCH_MAX_AGE_MS);
+// Kebijakan kirim berdasarkan perubahan nilai (GPS dan SOS gateway)
+ReportPolicy policy;
+// Posisi dikirim sebagai keyframe + delta
+PositionEncoder positions(GPS_KEYFRAME_EVERY, REPORT_MAX_SILENCE_MS);
+// Frame yang hilang (tidak di-ACK atau antrian TX penuh), terakhir dilihat
+static uint32_t lostFrames = 0;
 
 void IRAM_ATTR handle_button_callback(){
     uint32_t now = millis();
@@ -66,63 +109,74 @@ void IRAM_ATTR handle_button_callback(){
 // =============================================
 // GPS Task
 // =============================================
+// Task tidur sampai UART selesai menerima satu burst NMEA, lalu semua byte
+// dibaca sekaligus dan fix terbaru ditaruh di mailbox (queue 1 elemen).
+void onGPSReceive()
+{
+    // Dipanggil dari task event UART
+    if (gpsTaskHandle)
+        xTaskNotifyGive(gpsTaskHandle);
+}
+
 void gps_task(void *pvParameters)
 {
-    GPSData *data = (GPSData *)pvParameters;
+    QueueHandle_t mailbox = (QueueHandle_t)pvParameters;
+#ifndef GPS_SIMULATE
+    uint32_t lastPublish = 0;
+    bool published = false;
+    float lastCourse = 0;
+    uint8_t buf[128];
+    GPSSerial.setRxBufferSize(GPS_RX_BUFFER);
+    GPSSerial.onReceive(onGPSReceive, true);
     GPSSerial.begin(GPS_BAUD, SERIAL_8N1, GPIO_NUM_43, GPIO_NUM_44); // RX, TX
+#endif
     while (true)
     {
+#ifdef GPS_SIMULATE
+        // Lokasi statis untuk pengujian tanpa modul GPS
+        vTaskDelay(pdMS_TO_TICKS(GPS_STATIONARY_INTERVAL_MS));
+        GPSData fix = {-7.334967968864027f, 112.78784320020455f, 0, true};
+#else
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_IDLE_WAKE_MS));
+        size_t n;
+        while ((n = GPSSerial.read(buf, sizeof(buf))) > 0)
+        {
+            for (size_t i = 0; i < n; i++)
+                gps.encode(buf[i]);
+        }
+        if (!gps.location.isUpdated())
+            continue;
+        if (!gps.location.isValid())
+        {
+            Serial.println("[GPS] Location invalid");
+            continue;
+        }
         uint32_t now = millis();
-        // while (GPSSerial.available())
-        // {
-        //     char c = GPSSerial.read();
-        //     gps.encode(c);
-        // }
-        // if (gps.location.isUpdated())
-        // {
-        //     if (!gps.location.isValid())
-        //     {
-        //         Serial.println("[GPS] Location invalid");
-        //         continue;
-        //     }
-        //     if (now - timers.gps_tick < GPS_INTERVAL_MS)
-        //         continue;
-        //     timers.gps_tick = now;
-        //     data->lattitude = gps.location.lat();
-        //     data->longitude = gps.location.lng();
-        //     data->isNew = true;
-        //     Serial.printf("[GPS] New location: %.6f, %.6f\n", data->lattitude, data->longitude);
-        // }
-        if (now - timers.gps_tick < GPS_INTERVAL_MS)
+        float speed = gps.speed.isValid() ? gps.speed.kmph() : 0;
+        bool moving = speed >= GPS_MOVING_KMPH;
+        uint32_t interval = moving ? GPS_MOVING_INTERVAL_MS : GPS_STATIONARY_INTERVAL_MS;
+        // Belokan tajam saat bergerak langsung dilaporkan
+        float course = gps.course.isValid() ? gps.course.deg() : lastCourse;
+        float turn = fabsf(course - lastCourse);
+        if (turn > 180)
+            turn = 360 - turn;
+        bool turned = moving && turn >= GPS_COURSE_CHANGE_DEG;
+        if (published && !turned && now - lastPublish < interval)
             continue;
-        timers.gps_tick = now;
-        data->lattitude = -7.334967968864027;
-        data->longitude = 112.78784320020455;
-        data->isNew = true;
-        Serial.printf("[GPS] New location: %.6f, %.6f\n", data->lattitude, data->longitude);
-        vTaskDelay(100 / portTICK_PERIOD_MS);
-    }
-}
+        lastPublish = now;
+        lastCourse = course;
+        GPSData fix;
+        fix.lattitude = gps.location.lat();
+        fix.longitude = gps.location.lng();
+        fix.speed_kmph = speed;
+        fix.isNew = true;
+        published = true;
 #endif
-std::string TopictoString(Topic topic)
-{
-    switch (topic)
-    {
-    case Topic::HEART_RATE:
-        return "heart_rate";
-    case Topic::SPO2:
-        return "spo2";
-    case Topic::STRESS:
-        return "stress";
-    case Topic::GPS:
-        return "GPS";
-    case Topic::SOS:
-        return "SOS";
-    default:
-        return "unknown";
+        xQueueOverwrite(mailbox, &fix);
+        Serial.printf("[GPS] New location: %.6f, %.6f (%.1f km/h)\n", fix.lattitude, fix.longitude, fix.speed_kmph);
     }
 }
-
+#endif
 #ifdef DEVICE_MODE_BASE
 // MQTT setup
 const char *WIFI_SSID = "vivoaswin";
@@ -132,10 +186,45 @@ const uint16_t MQTT_PORT = 1883;
 const char *MQTT_USER = "mqtt";
 const char *MQTT_PASS = "mqttpass";
 const char *MQTT_TOPIC = "device/health";
-const char *API_URL = "http://smartazone.my.id/api/update-log";
-const char *SOS_API_URL = "http://smartazone.my.id/api/sos-trigger";
+const char *MQTT_SOS_TOPIC = "device/sos";
+// Untuk uji lokal arahkan API_HOST/API_PORT ke server HTTP di LAN
+const char *API_HOST = "smartazone.my.id";
+const uint16_t API_PORT = 80;
+const char *API_PATH = "/api/update-log";
+const char *SOS_API_PATH = "/api/sos-trigger";
 MqttManager mqtt(WIFI_SSID, WIFI_PASS, MQTT_SERVER, MQTT_PORT, MQTT_USER, MQTT_PASS);
-AsyncHTTPRequest request;
+#ifdef UPLINK_MQTT
+// Pembacaan semua device di-batch jadi satu payload MessagePack per publish
+static const size_t MQTT_BATCH_MAX = 32;
+static const uint32_t MQTT_FLUSH_MS = 1000;
+static const uint32_t MQTT_PUBLISH_PER_SEC = 4;  // rata-rata publish per detik
+static const uint32_t MQTT_PUBLISH_BURST = 8;
+static const uint32_t MQTT_RETRY_MS = 2000;
+MqttUplink uplink(mqtt, MQTT_TOPIC, MQTT_SOS_TOPIC, MQTT_BATCH_MAX, MQTT_FLUSH_MS,
+                  MQTT_PUBLISH_PER_SEC, MQTT_PUBLISH_BURST, MQTT_RETRY_MS);
+#else
+// Satu koneksi keep-alive ke API, beberapa POST boleh in-flight
+static const size_t HTTP_PIPELINE_DEPTH = 4;
+static const uint32_t HTTP_TIMEOUT_MS = 10000;
+HttpPipeline http(API_HOST, API_PORT, HTTP_PIPELINE_DEPTH, HTTP_TIMEOUT_MS);
+// Koneksi terpisah untuk SOS supaya tidak antre di belakang batch
+static const uint32_t SOS_HTTP_TIMEOUT_MS = 5000;
+HttpPipeline sosHttp(API_HOST, API_PORT, 1, SOS_HTTP_TIMEOUT_MS);
+// Pembacaan dikumpulkan lalu di-POST sebagai JSON array
+static const size_t UPLINK_BATCH_MAX = 16;
+static const uint32_t UPLINK_FLUSH_MS = 2000;
+static const uint32_t UPLINK_RETRY_MS = 5000;
+UplinkQueue uplink(http, sosHttp, API_PATH, SOS_API_PATH, UPLINK_BATCH_MAX, UPLINK_FLUSH_MS, UPLINK_RETRY_MS);
+// Journal di partisi "journal" (64 KB, ~2600 pembacaan) untuk menampung
+// data saat WiFi/API down
+static const uint32_t UPLINK_REPLAY_MS = 1000;               // jeda antar POST replay
+PartitionJournalStorage journalStorage("journal");
+Journal journal(journalStorage);
+#endif
+// Keyframe GPS terakhir per device untuk decode delta
+PositionDecoder positions;
+// Status dan statistik link per wearable, dump lewat serial ('d')
+DeviceTable devices;
 
 // =============================================
 // Sinkronisasi waktu (NTP)
@@ -181,68 +270,6 @@ void setupTime()
     }
 }
 
-void PostDeviceData(const DeviceData &data){
-    static bool requestOpenResult = false;
-    StaticJsonDocument<256> doc;
-    doc["device_id"] = data.device_id;
-    if (data.topic == Topic::GPS || data.topic == Topic::SOS)
-    {
-        doc["lattitude"] = data.sensor.location.lattitude;
-        doc["longitude"] = data.sensor.location.longitude;
-    }
-    else if (data.topic == Topic::HEART_RATE )
-    {
-        doc["heart_rate"] = data.sensor.value;
-    }
-    else if (data.topic == Topic::SPO2 )
-    {
-        doc["spo2"] = data.sensor.value;
-    }
-    else if (data.topic == Topic::STRESS )
-    {
-        doc["stress_level"] = data.sensor.value;
-    }
-    String json;
-    const char *URL; 
-    if (data.topic == Topic::SOS )
-       URL =  SOS_API_URL;
-    else
-        URL =  API_URL;
-    serializeJson(doc, json);
-    Serial.println("[HTTP] Preparing to post to " + String(URL));
-    if (request.readyState() == readyStateUnsent || request.readyState() == readyStateDone){
-        requestOpenResult =  request.open("POST", URL);
-        request.setReqHeader("Content-Type", "application/json");
-        if (!requestOpenResult){
-            Serial.println("[HTTP] Failed to open request");
-            return;
-        }else{
-            request.send(json);
-            Serial.println("[HTTP] Posting data: " + json);
-        }
-    }else{
-        Serial.println("[HTTP] Request busy, skipping...");
-    }
-}
-
-void requestCallback(void *optParm,AsyncHTTPRequest* request, int readyState)
-{
-    (void) optParm;
-    if (readyState == readyStateDone)
-    {
-        int status = request->responseHTTPcode();
-        String response = request->responseText();
-        if (status == 200|| status == 201)
-        {
-            Serial.println("[HTTP] Response: " + response);
-        }
-        else
-        {
-            Serial.printf("[HTTP] Error: status code %d\n", status );
-            Serial.println(response);
-        }
-    }
-}
 
 struct Timers
 {
@@ -265,9 +292,59 @@ static const uint8_t LORA_MISO = 3;
 static const uint8_t LORA_DIO1 = 33;
 static const uint8_t LORA_BUSY = 34;
 static const uint8_t LORA_RST = 8;
+// Panjang slot TDMA (TX 64 byte SF7 + ACK), 0 = ALOHA tanpa beacon
+static const uint16_t TDMA_SLOT_MS = 400;
+// Channel plan client dan base harus sama; channel 0 = channel kontrol
+static const ChannelPlan &LORA_CHANNELS = AS923_PLAN;
+// Batas ADR: SF slot TDMA (base) dan daya TX dBm (client)
+static const AdrLimits LORA_ADR = {LORA_SF_MIN, LORA_SF_MAX, 2, 14};
 
 LoRaHandler lora(LORA_NSS, LORA_DIO1, LORA_RST, LORA_BUSY, LORA_SCK, LORA_MISO, LORA_MOSI);
 static const uint32_t STATUS_INTERVAL_MS = 60000;
+
+#ifdef DEVICE_MODE_CLIENT
+// =============================================
+// Batch LoRa
+// =============================================
+void flushBatch()
+{
+    if (batch.empty())
+        return;
+    uint8_t frame[BATCH_MAX_FRAME_LEN];
+    bool urgent = batch.hasSos();
+    size_t len = batch.encode(frame, sizeof(frame));
+    Serial.printf("[LoRa] Flush batch: %u records, %u bytes\n", batch.count(), (unsigned)len);
+    if (len)
+        lora.enqueue(frame, len, urgent);
+    batch.clear();
+}
+
+void queueReading(ReportPolicy &reportPolicy, const DeviceData &data, uint32_t now)
+{
+    if (!reportPolicy.shouldReport(data, now))
+    {
+        Serial.printf("[Policy] %s unchanged, skipped\n", topicName(data.topic));
+        return;
+    }
+    DeviceData record = data;
+    if (data.topic == Topic::GPS)
+        record = positions.encode(data.device_id, data.sensor.location, now);
+    // SOS dikirim sendiri sebagai frame urgent (frame terpendek, antrian
+    // prioritas), batch yang sedang terkumpul dikirim biasa lebih dulu
+    if (data.topic == Topic::SOS)
+    {
+        flushBatch();
+        batch.add(record, now);
+        flushBatch();
+        return;
+    }
+    if (!batch.add(record, now))
+    {
+        flushBatch();
+        batch.add(record, now);
+    }
+}
+#endif
 #ifdef DEVICE_MODE_BASE
 
 #endif
@@ -285,7 +362,8 @@ void setup()
 
 #ifdef DEVICE_MODE_CLIENT
     Serial.println(F("[Main] Mode: CLIENT"));
-    ble.begin("EoRa-S3");
+    for (size_t i = 0; i < WEARER_COUNT; i++)
+        wearers[i].begin("EoRa-S3");
     if (!lora.begin(923.0))
     {
         Serial.println(F("[Main] LoRa init failed"));
@@ -293,16 +371,32 @@ void setup()
             delay(1000);
     }
     Serial.println(F("[Main] LoRa ready"));
+    lora.setChannelPlan(LORA_CHANNELS);
+    lora.setAdrLimits(LORA_ADR);
+    if (TDMA_SLOT_MS)
+        lora.listenForBeacons(DEVICE_ID);
+    // seq batch mulai dari 0 setiap boot, base diberi tahu lewat boot_id
+    batch.setBootId((uint8_t)esp_random());
+    for (size_t i = 0; i < WEARER_COUNT; i++)
+    {
+        ReportPolicy &p = wearerState[i].policy;
+        p.setRule(Topic::HEART_RATE, HR_DEADBAND_BPM, REPORT_MAX_SILENCE_MS);
+        p.setRule(Topic::HEART_RATE_SUMMARY, HR_DEADBAND_BPM, REPORT_MAX_SILENCE_MS);
+        p.setRule(Topic::SPO2, SPO2_DEADBAND_PCT, REPORT_MAX_SILENCE_MS);
+        p.setRule(Topic::STRESS, STRESS_DEADBAND, REPORT_MAX_SILENCE_MS);
+    }
+    policy.setRule(Topic::GPS, GPS_DEADBAND_M, REPORT_MAX_SILENCE_MS);
     // for auto start trigger
     timers.triggerTick = -300000;
     // Start GPS task
+    gpsMailbox = xQueueCreate(1, sizeof(GPSData));
     xTaskCreatePinnedToCore(
         gps_task,         /* Task function. */
         "GPS Task",       /* name of task. */
         4096,             /* Stack size of task */
-        (void *)&gpsData, /* parameter of the task */
+        (void *)gpsMailbox, /* parameter of the task */
         1,                /* priority of the task */
-        NULL,             /* Task handle to keep track of created task */
+        &gpsTaskHandle,   /* Task handle to keep track of created task */
         1);               /* pin task to core 1 */
     pinMode(GPIO_NUM_47,OUTPUT);
     digitalWrite(GPIO_NUM_47,LOW);
@@ -313,9 +407,24 @@ void setup()
     setupTime();
     Serial.println(F("[Main] Mode: BASE"));
     lora.begin(923.0);
-    request.setDebug(false);
-    request.onReadyStateChange(requestCallback);
-    // mqtt.begin();
+    lora.setChannelPlan(LORA_CHANNELS);
+    lora.setAdrLimits(LORA_ADR);
+    lora.attachDeviceTable(&devices);
+    lora.startListening(TDMA_SLOT_MS);
+#ifdef UPLINK_MQTT
+    mqtt.setBufferSize(MQTT_PACKET_LEN);
+    mqtt.begin();
+#else
+    if (journalStorage.open() && journal.begin())
+    {
+        Serial.printf("[Journal] Ready, %lu pending of %lu slots\n", journal.pending(), journal.capacity());
+        uplink.attachJournal(&journal, UPLINK_REPLAY_MS);
+    }
+    else
+    {
+        Serial.println(F("[Journal] Init failed, uplink runs without journal"));
+    }
+#endif
 #endif
 }
 
@@ -331,10 +440,85 @@ void loop()
     {
         timers.status = now;
         Serial.printf("[Status] Uptime:%lus | Heap:%u bytes\n", now / 1000, ESP.getFreeHeap());
+#ifdef DEVICE_MODE_CLIENT
+        LoRaTxStats tx = lora.txStats();
+        Serial.printf("[Status] LoRa TX queued:%lu inFlight:%d sent:%lu failed:%lu dropped:%lu\n",
+                      tx.queued, tx.inFlight, tx.sent, tx.failed, tx.dropped);
+        Serial.printf("[Status] LoRa ACK acked:%lu retries:%lu noAck:%lu | TDMA beacons:%lu synced:%d\n",
+                      tx.acked, tx.retries, tx.noAck, tx.beacons, tx.synced);
+        Serial.printf("[Status] LoRa ADR slot SF%u power:%d dBm margin:%d dB\n", tx.slotSf, tx.power, tx.margin);
+        Serial.printf("[Status] SOS queued:%lu acked:%lu last:%lu avg:%lu max:%lu ms overBudget:%lu\n",
+                      tx.urgentQueued, tx.sos.delivered, tx.sos.lastMs, tx.sos.avgMs(), tx.sos.maxMs, tx.sos.overBudget);
+        for (uint8_t ch = 0; ch < lora.channelCount(); ch++)
+        {
+            LoRaChannelStats cs = lora.channelStats(ch);
+            Serial.printf("[Status] LoRa ch%u %.1f MHz tx:%lu\n", ch, cs.freq, cs.tx);
+        }
+        Serial.printf("[Status] Policy suppressed:%lu\n", policy.suppressed());
+        for (size_t i = 0; i < WEARER_COUNT; i++)
+        {
+            BLEManager &ble = wearers[i];
+            unsigned id = ble.deviceId();
+            Serial.printf("[Status] BLE %u connected:%d ready:%d samples dropped:%lu | Policy suppressed:%lu\n",
+                          id, ble.isConnected(), ble.isReady(), ble.droppedSamples(), wearerState[i].policy.suppressed());
+            BLEReconnectStats rc = ble.reconnectStats();
+            Serial.printf("[Status] BLE %u connect attempts:%lu direct:%lu scan:%lu failed:%lu last:%lu avg:%lu max:%lu ms gap:%lu ms\n",
+                          id, rc.attempts, rc.direct, rc.scanned, rc.failed, rc.lastMs, rc.avgMs, rc.maxMs, rc.lastGapMs);
+            Serial.printf("[Status] BLE %u GATT cached:%lu discoveries:%lu\n", id, rc.cached, rc.discoveries);
+            AolonDecoderStats fs = ble.frameStats();
+            Serial.printf("[Status] BLE %u frames:%lu unknown:%lu malformed:%lu discarded:%lu bytes\n",
+                          id, fs.frames, fs.unknown, fs.malformed, fs.discarded);
+            BLECommandStats cmd = ble.commandStats();
+            Serial.printf("[Status] BLE %u cmd queued:%lu sent:%lu retries:%lu answered:%lu timeouts:%lu dropped:%lu last:%lu avg:%lu max:%lu ms\n",
+                          id, cmd.queued, cmd.sent, cmd.retries, cmd.answered, cmd.timeouts, cmd.dropped, cmd.lastMs, cmd.avgMs, cmd.maxMs);
+        }
+#elif defined(DEVICE_MODE_BASE)
+        LoRaRxStats rx = lora.rxStats();
+        Serial.printf("[Status] LoRa RX received:%lu sos:%lu duplicates:%lu gaps:%lu dropped:%lu acks:%lu devices:%u\n",
+                      rx.received, rx.urgent, rx.duplicates, rx.gaps, rx.dropped, rx.acksSent, (unsigned)devices.count());
+        Serial.printf("[Status] TDMA beacons:%lu slots:%u superframe:%lu ms\n", rx.beacons, rx.slots, rx.superframeMs);
+        for (uint8_t ch = 0; ch < lora.channelCount(); ch++)
+        {
+            LoRaChannelStats cs = lora.channelStats(ch);
+            uint32_t busy = cs.scans ? cs.activity * 100 / cs.scans : 0;
+            Serial.printf("[Status] LoRa ch%u %.1f MHz rx:%lu scans:%lu activity:%lu%%\n",
+                          ch, cs.freq, cs.rx, cs.scans, busy);
+        }
+#ifdef UPLINK_MQTT
+        MqttUplinkStats up = uplink.stats();
+        Serial.printf("[Status] MQTT queued:%lu published:%lu publishes:%lu bytes:%lu failed:%lu dropped:%lu congested:%d\n",
+                      up.queued, up.published, up.publishes, up.bytes, up.failed, up.dropped, up.congested);
+        Serial.printf("[Status] SOS queued:%lu published:%lu last:%lu avg:%lu max:%lu ms overBudget:%lu\n",
+                      up.sosQueued, up.sos.delivered, up.sos.lastMs, up.sos.avgMs(), up.sos.maxMs, up.sos.overBudget);
+#else
+        UplinkStats up = uplink.stats();
+        Serial.printf("[Status] Uplink queued:%lu inFlight:%lu posted:%lu requests:%lu failed:%lu dropped:%lu journal:%lu congested:%d\n",
+                      up.queued, up.inFlight, up.posted, up.requests, up.failed, up.dropped, up.journaled, up.congested);
+        HttpLatencyStats lat = http.stats();
+        Serial.printf("[Status] HTTP latency last:%lu min:%lu avg:%lu max:%lu ms (%lu done) connects:%lu errors:%lu\n",
+                      lat.lastMs, lat.minMs, lat.avgMs, lat.maxMs, lat.completed, lat.connects, lat.errors);
+        Serial.printf("[Status] SOS queued:%lu posted:%lu failed:%lu last:%lu avg:%lu max:%lu ms overBudget:%lu\n",
+                      up.sosQueued, up.sos.delivered, up.sosFailed, up.sos.lastMs, up.sos.avgMs(), up.sos.maxMs,
+                      up.sos.overBudget);
+#endif
+#endif
     }
 
 #ifdef DEVICE_MODE_CLIENT
-    BLEData HR, SpO2, Stress;
+    // Selesaikan TX yang sedang on-air dan mulai frame berikutnya
+    lora.poll();
+    LoRaTxStats txNow = lora.txStats();
+    if (batch.announcingBoot() && txNow.acked)
+        batch.bootAcked();
+    // Frame hilang mungkin membawa keyframe GPS: tanpa itu base membuang
+    // semua delta berikutnya, jadi posisi berikutnya dikirim sebagai keyframe
+    if (txNow.noAck + txNow.dropped != lostFrames)
+    {
+        lostFrames = txNow.noAck + txNow.dropped;
+        positions.reset();
+    }
+
+    BLESample sample;
     DeviceData new_data;
     if (is_pressed &&( timers.hold_tick == UINT32_MAX))
         timers.hold_tick = now;
@@ -348,66 +532,59 @@ void loop()
         data.sensor.location.lattitude = gpsData.lattitude;
         data.sensor.location.longitude = gpsData.longitude;
         data.topic= Topic::SOS;
-        new_data = data;
-        lora.transmit((uint8_t*)&new_data, sizeof(DeviceData));
+        queueReading(policy, data, now);
         Serial.printf("send sos trigger data\n");
     }
-    // Reconnect BLE jika terputus
-    if (now - timers.bleReconnect >= BLE_RECONNECT_MS)
-    {
-        timers.bleReconnect = now;
-        if (!ble.isConnected())
-        {
-            Serial.println("[BLE] Reconnecting...");
-            if (ble.tryReconnect())
-            {
-                Serial.println("[BLE] Notify re-enabled after reconnect");
-            }
-        }
-    }
-
-    // Trigger SPO2 dan STRESS setiap 10 detik
-    if (ble.isConnected() && (now - timers.triggerTick >= TRIGGER_INTERVAL_MS))
+    // Trigger SPO2 lalu STRESS setiap TRIGGER_INTERVAL_MS, untuk semua band
+    bool triggerSpO2 = now - timers.triggerTick >= TRIGGER_INTERVAL_MS;
+    bool triggerStress = !triggerSpO2 && !streesTriggerPending && now >= timers.interval_spo_stress;
+    if (triggerSpO2)
     {
         timers.triggerTick = now;
-        Serial.println("[BLE] Triggering SPO2 sensors...");
-        ble.triggerSpO2();
-        delay(500);
-        ble.triggerSpO2();
         timers.interval_spo_stress = now + INTERVAL_BETWEEN_SPO2_STRESS;
         streesTriggerPending = false;
+        Serial.println("[BLE] Triggering SPO2 sensors...");
     }
-    if (ble.isConnected() && !streesTriggerPending && (now >= timers.interval_spo_stress))
+    if (triggerStress)
     {
-        Serial.println("[BLE] Triggering Stress sensor");
-        ble.triggerStress();
-        delay(500);
-        ble.triggerStress();
         streesTriggerPending = true;
+        Serial.println("[BLE] Triggering Stress sensor");
     }
-
-    HR = ble.getLastHR();
-    SpO2 = ble.getLastSpO2();
-    Stress = ble.getLastStress();
-    if (HR.isNew)
-    {
-        Serial.printf("send hr data: %d \n", HR.data);
-        new_data = ble.BLEDataToSensorData(DEVICE_ID, Topic::HEART_RATE, HR);
-        lora.transmit((uint8_t*)&new_data, sizeof(DeviceData));
-    }
-    if (SpO2.isNew)
-    {
-        Serial.printf("send spo2 data: %d \n", SpO2.data);
-        new_data = ble.BLEDataToSensorData(DEVICE_ID, Topic::SPO2, SpO2);
-        lora.transmit((uint8_t*)&new_data, sizeof(DeviceData));
-    }
-    if (Stress.isNew)
+    for (size_t i = 0; i < WEARER_COUNT; i++)
     {
-        Serial.printf("send Stress data: %d \n", Stress.data);
-        new_data = ble.BLEDataToSensorData(DEVICE_ID, Topic::STRESS, Stress);
-        lora.transmit((uint8_t*)&new_data, sizeof(DeviceData));
+        BLEManager &ble = wearers[i];
+        WearerState &state = wearerState[i];
+        if (triggerSpO2)
+            ble.triggerSpO2();
+        if (triggerStress)
+            ble.triggerStress();
+        // Kirim perintah BLE yang antri, retry jika band belum menjawab
+        ble.loop(now);
+
+        // Kuras semua sampel BLE yang masuk sejak loop sebelumnya
+        while (ble.popSample(sample))
+        {
+            if (sample.topic == Topic::HEART_RATE && HR_WINDOW_MS)
+            {
+                state.hrWindow.add(sample.value, sample.timestamp);
+                continue;
+            }
+            Serial.printf("send %s data from %u: %d (t=%lu)\n", topicName(sample.topic), ble.deviceId(), sample.value, sample.timestamp);
+            queueReading(state.policy, ble.sampleToDeviceData(sample), now);
+        }
+        if (state.hrWindow.ready(now))
+        {
+            new_data = DeviceData();
+            new_data.device_id = ble.deviceId();
+            new_data.topic = Topic::HEART_RATE_SUMMARY;
+            new_data.sensor.summary = state.hrWindow.take();
+            Serial.printf("send hr summary from %u: min %d max %d mean %d last %d (%d samples)\n", ble.deviceId(),
+                          new_data.sensor.summary.min, new_data.sensor.summary.max, new_data.sensor.summary.mean,
+                          new_data.sensor.summary.last, new_data.sensor.summary.count);
+            queueReading(state.policy, new_data, now);
+        }
     }
-    if (gpsData.isNew)
+    if (xQueueReceive(gpsMailbox, &gpsData, 0) == pdTRUE)
     {
         gpsData.isNew = false;
         Serial.printf("send GPS data: (%.6f, %.6f) \n", gpsData.lattitude, gpsData.longitude);
@@ -416,46 +593,62 @@ void loop()
         new_data.topic = Topic::GPS;
         new_data.sensor.location.lattitude = gpsData.lattitude;
         new_data.sensor.location.longitude = gpsData.longitude;
-        lora.transmit((uint8_t*)&new_data, sizeof(DeviceData));
+        queueReading(policy, new_data, now);
     }
+    if (batch.shouldFlush(now))
+        flushBatch();
+    lora.poll();
 #elif defined(DEVICE_MODE_BASE)
-    // Mode RX → terima dan forward ke MQTT
-    // mqtt.loop();
-    String msg;
+    // Mode RX → terima dan forward ke uplink (HTTP atau MQTT)
     DeviceData device_data;
     struct tm timeinfo;
     char timeStringBuff[64];
-    String mqtt_payload;
-    std::string full_topic;
-    if (!getLocalTime(&timeinfo))
+    // Perintah serial: 'd' = dump tabel device
+    while (Serial.available())
     {
-        Serial.println("Failed to obtain time");
-        return;
+        if (Serial.read() == 'd')
+            devices.dump(Serial, now);
     }
-    strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%d %H:%M:%S", &timeinfo);
-    if (lora.receive())
+    // Tanpa menunggu NTP (timeout 0), frame tetap diteruskan meski jam
+    // belum sinkron supaya SOS tidak tertahan
+    if (getLocalTime(&timeinfo, 0))
+        strftime(timeStringBuff, sizeof(timeStringBuff), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    else
+        strcpy(timeStringBuff, "time not synced");
+    // Kuras semua frame yang sudah masuk ring buffer, SOS lebih dulu.
+    // Selama uplink tersendat hanya SOS yang diambil (frame biasa
+    // menumpuk di antrian RX lalu tidak di-ACK).
+    while (lora.receive(uplink.congested()))
     {
         receivedPacket packet = lora.getNewPacket();
         if (!packet.isNew)
-            return;
-        device_data = packet.device_data;
-        if (device_data.topic != Topic::GPS && device_data.topic != Topic::SOS)
-        {
-            std::string topic_str = TopictoString(device_data.topic);
-            Serial.printf("[LORA] get data from device: %d on Topic : %s and value: %d\n at %s\n", device_data.device_id, topic_str.c_str(), device_data.sensor.value, timeStringBuff);
-            mqtt_payload = String(device_data.sensor.value);
-            full_topic = std::to_string(device_data.device_id) + "/" + TopictoString(device_data.topic);
-        }
-        else
+            break;
+        for (uint8_t i = 0; i < packet.count; i++)
         {
-            Serial.printf("[LORA] get data from device: %d on Topic : %s and location: (%.6f, %.6f) at %s\n", device_data.device_id, TopictoString(device_data.topic).c_str(), device_data.sensor.location.lattitude, device_data.sensor.location.longitude, timeStringBuff);
-            mqtt_payload = String("{\"lattitude\":") + String(device_data.sensor.location.lattitude, 6) + String(", \"longitude\":") + String(device_data.sensor.location.longitude, 6) + String("}");
-            full_topic = std::to_string(device_data.device_id) + "/" + TopictoString(device_data.topic);
+            device_data = packet.records[i];
+            if (!positions.resolve(device_data))
+                continue;
+            devices.onReading(device_data, now);
+            if (device_data.topic == Topic::HEART_RATE_SUMMARY)
+            {
+                const HRSummary &sum = device_data.sensor.summary;
+                Serial.printf("[LORA] get data from device: %d on Topic : %s min %d max %d mean %d last %d (%d samples) at %s\n", device_data.device_id, topicName(device_data.topic), sum.min, sum.max, sum.mean, sum.last, sum.count, timeStringBuff);
+            }
+            else if (device_data.topic != Topic::GPS && device_data.topic != Topic::SOS)
+            {
+                Serial.printf("[LORA] get data from device: %d on Topic : %s and value: %d\n at %s\n", device_data.device_id, topicName(device_data.topic), device_data.sensor.value, timeStringBuff);
+            }
+            else
+            {
+                Serial.printf("[LORA] get data from device: %d on Topic : %s and location: (%.6f, %.6f) at %s\n", device_data.device_id, topicName(device_data.topic), device_data.sensor.location.lattitude, device_data.sensor.location.longitude, timeStringBuff);
+            }
+            uplink.push(device_data, getCurrentTime(), packet.rxTick);
         }
-        PostDeviceData(device_data);
-        // if (mqtt.isConnected())
-        //     mqtt.publish((char *)full_topic.c_str(), mqtt_payload);
     }
+    // Kirim uplink setelah frame dikuras, SOS yang baru masuk langsung di-POST
+    uplink.loop(millis());
 #endif
-    delay(50);
+    // Satu tick supaya idle task jalan; TX/ACK, slot TDMA dan SOS tetap
+    // dilayani dengan resolusi 1 ms
+    vTaskDelay(1);
 }
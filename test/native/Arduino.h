@@ -0,0 +1,92 @@
+#pragma once
+// Pengganti minimal Arduino.h untuk unit test di host (env:native).
+// Hanya yang dipakai library yang diuji: tipe integer, math, Serial,
+// millis() dan task FreeRTOS (dijalankan sebagai std::thread).
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using std::max;
+using std::min;
+
+#define F(x) x
+#define radians(deg) ((deg) * 0.017453292519943295)
+
+struct HostSerial
+{
+    template <typename... Args>
+    void printf(const char *fmt, Args... args) { ::printf(fmt, args...); }
+    void println(const char *s = "") { ::printf("%s\n", s); }
+    void print(const char *s) { ::printf("%s", s); }
+};
+
+inline HostSerial Serial;
+
+inline uint32_t millis()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// ===========================================
+// Task FreeRTOS minimal: task = thread detached, notify = counter + cv
+// ===========================================
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+static constexpr BaseType_t pdPASS = 1;
+static constexpr BaseType_t pdFAIL = 0;
+static constexpr BaseType_t pdTRUE = 1;
+static constexpr TickType_t portMAX_DELAY = 0xFFFFFFFF;
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct HostTask
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notified = 0;
+};
+typedef HostTask *TaskHandle_t;
+
+inline thread_local HostTask *hostCurrentTask = nullptr;
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *, uint32_t, void *param,
+                                          int, TaskHandle_t *handle, int)
+{
+    HostTask *task = new HostTask();
+    *handle = task;
+    std::thread([=]() {
+        hostCurrentTask = task;
+        fn(param);
+    }).detach();
+    return pdPASS;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notified++;
+    task->cv.notify_one();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+    HostTask *task = hostCurrentTask;
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto ready = [task]() { return task->notified > 0; };
+    if (wait == portMAX_DELAY)
+        task->cv.wait(guard, ready);
+    else
+        task->cv.wait_for(guard, std::chrono::milliseconds(wait), ready);
+    uint32_t n = task->notified;
+    if (n)
+        task->notified = clear ? 0 : n - 1;
+    return n;
+}
@@ -0,0 +1,95 @@
+#pragma once
+// WiFiClient palsu untuk unit test di host: request yang ditulis disimpan
+// sebagai body, dijawab dengan fakeServer.status (0 = response ditahan).
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+struct FakeRequest
+{
+    std::string body;
+    int status;
+};
+
+struct FakeServer
+{
+    bool up = true; // connect berhasil
+    int status = 200;
+    std::vector<FakeRequest> answered; // urut sesuai response
+};
+
+inline FakeServer fakeServer;
+
+class WiFiClient
+{
+public:
+    int connect(const char *, uint16_t, int32_t = 0)
+    {
+        stop();
+        open = fakeServer.up;
+        return open;
+    }
+    uint8_t connected() { return open || rx.size() > rxPos; }
+    int available()
+    {
+        answer();
+        return (int)(rx.size() - rxPos);
+    }
+    int read()
+    {
+        if (rxPos >= rx.size())
+            return -1;
+        return (uint8_t)rx[rxPos++];
+    }
+    size_t write(const uint8_t *buf, size_t len)
+    {
+        if (!open)
+            return 0;
+        tx.append((const char *)buf, len);
+        parse();
+        return len;
+    }
+    void stop()
+    {
+        open = false;
+        tx.clear();
+        rx.clear();
+        rxPos = 0;
+        held.clear();
+    }
+    void setNoDelay(bool) {}
+
+private:
+    bool open = false;
+    std::string tx, rx;
+    size_t rxPos = 0;
+    std::vector<std::string> held; // request lengkap yang belum dijawab
+
+    void parse()
+    {
+        while (true)
+        {
+            size_t end = tx.find("\r\n\r\n");
+            if (end == std::string::npos)
+                return;
+            size_t cl = tx.find("Content-Length: ");
+            size_t len = cl < end ? strtoul(tx.c_str() + cl + 16, nullptr, 10) : 0;
+            if (tx.size() < end + 4 + len)
+                return;
+            held.push_back(tx.substr(end + 4, len));
+            tx.erase(0, end + 4 + len);
+        }
+    }
+
+    void answer()
+    {
+        if (!open || !fakeServer.status)
+            return;
+        for (const std::string &body : held)
+        {
+            fakeServer.answered.push_back({body, fakeServer.status});
+            rx += "HTTP/1.1 " + std::to_string(fakeServer.status) + " X\r\nContent-Length: 0\r\n\r\n";
+        }
+        held.clear();
+    }
+};
@@ -0,0 +1,32 @@
+#pragma once
+// Deklarasi esp_partition untuk unit test di host. Partisi tidak pernah
+// ditemukan; test memakai JournalStorage sendiri.
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+static constexpr esp_err_t ESP_OK = 0;
+static constexpr esp_err_t ESP_FAIL = -1;
+static constexpr uint32_t SPI_FLASH_SEC_SIZE = 4096;
+
+enum esp_partition_type_t
+{
+    ESP_PARTITION_TYPE_DATA = 1
+};
+enum esp_partition_subtype_t
+{
+    ESP_PARTITION_SUBTYPE_ANY = 0xFF
+};
+
+struct esp_partition_t
+{
+    uint32_t size;
+};
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char *)
+{
+    return nullptr;
+}
+inline esp_err_t esp_partition_read(const esp_partition_t *, size_t, void *, size_t) { return ESP_FAIL; }
+inline esp_err_t esp_partition_write(const esp_partition_t *, size_t, const void *, size_t) { return ESP_FAIL; }
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t, size_t) { return ESP_FAIL; }
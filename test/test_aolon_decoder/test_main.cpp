@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <string.h>
+#include <aolon_decoder.h>
+
+// Hasil handler terakhir, di-reset di setUp()
+struct Seen
+{
+    int spo2;
+    int stress;
+    int frames;
+    int unknown;
+    uint8_t unknownCmd;
+};
+static Seen seen;
+
+static bool onSpO2(void *, const AolonFrame &frame)
+{
+    if (frame.len != 1)
+        return false;
+    seen.spo2 = frame.payload[0];
+    seen.frames++;
+    return true;
+}
+
+static bool onStress(void *, const AolonFrame &frame)
+{
+    if (frame.len != 3 || frame.payload[0] != 0x11 || frame.payload[1] != 0x00)
+        return false;
+    seen.stress = frame.payload[2];
+    seen.frames++;
+    return true;
+}
+
+static bool onUnknown(void *, const AolonFrame &frame)
+{
+    seen.unknown++;
+    seen.unknownCmd = frame.cmd;
+    return true;
+}
+
+static const AolonCommand HANDLERS[] = {
+    {0x6B, onSpO2},
+    {0xB9, onStress},
+};
+
+static const uint8_t SPO2_97[] = {0xFE, 0xEA, 0x20, 0x06, 0x6B, 97};
+static const uint8_t STRESS_42[] = {0xFE, 0xEA, 0x20, 0x08, 0xB9, 0x11, 0x00, 42};
+
+void setUp()
+{
+    memset(&seen, 0, sizeof(seen));
+    seen.spo2 = -1;
+    seen.stress = -1;
+}
+
+void tearDown() {}
+
+static AolonDecoder makeDecoder()
+{
+    return AolonDecoder(HANDLERS, sizeof(HANDLERS) / sizeof(HANDLERS[0]), nullptr, onUnknown);
+}
+
+void test_whole_frame()
+{
+    AolonDecoder d = makeDecoder();
+    d.feed(SPO2_97, sizeof(SPO2_97), 0);
+    TEST_ASSERT_EQUAL_INT(97, seen.spo2);
+    TEST_ASSERT_EQUAL_UINT32(1, d.stats().frames);
+    TEST_ASSERT_EQUAL_UINT32(0, d.stats().discarded);
+}
+
+void test_split_frame()
+{
+    AolonDecoder d = makeDecoder();
+    // Header dan payload di notifikasi berbeda, termasuk di tengah sync
+    d.feed(STRESS_42, 1, 0);
+    d.feed(STRESS_42 + 1, 3, 10);
+    TEST_ASSERT_EQUAL_INT(-1, seen.stress);
+    d.feed(STRESS_42 + 4, sizeof(STRESS_42) - 4, 20);
+    TEST_ASSERT_EQUAL_INT(42, seen.stress);
+    TEST_ASSERT_EQUAL_UINT32(1, d.stats().frames);
+}
+
+void test_merged_frames()
+{
+    AolonDecoder d = makeDecoder();
+    uint8_t both[sizeof(STRESS_42) + sizeof(SPO2_97) + 5];
+    memcpy(both, STRESS_42, sizeof(STRESS_42));
+    memcpy(both + sizeof(STRESS_42), SPO2_97, sizeof(SPO2_97));
+    // Frame cmd tak dikenal (tanpa payload) di ekor notifikasi yang sama
+    const uint8_t other[] = {0xFE, 0xEA, 0x20, 0x05, 0x01};
+    memcpy(both + sizeof(STRESS_42) + sizeof(SPO2_97), other, sizeof(other));
+    d.feed(both, sizeof(both), 0);
+    TEST_ASSERT_EQUAL_INT(42, seen.stress);
+    TEST_ASSERT_EQUAL_INT(97, seen.spo2);
+    TEST_ASSERT_EQUAL_INT(1, seen.unknown);
+    TEST_ASSERT_EQUAL_UINT8(0x01, seen.unknownCmd);
+    TEST_ASSERT_EQUAL_UINT32(2, d.stats().frames);
+    TEST_ASSERT_EQUAL_UINT32(1, d.stats().unknown);
+}
+
+void test_resync_after_garbage()
+{
+    AolonDecoder d = makeDecoder();
+    // Sampah, sync palsu (FE tanpa EA) dan panjang tidak valid sebelum frame
+    const uint8_t junk[] = {0x00, 0x13, 0xFE, 0x00, 0xFE, 0xEA, 0x20, 0x02};
+    uint8_t data[sizeof(junk) + sizeof(SPO2_97)];
+    memcpy(data, junk, sizeof(junk));
+    memcpy(data + sizeof(junk), SPO2_97, sizeof(SPO2_97));
+    d.feed(data, sizeof(data), 0);
+    TEST_ASSERT_EQUAL_INT(97, seen.spo2);
+    TEST_ASSERT_EQUAL_UINT32(1, d.stats().frames);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(junk), d.stats().discarded);
+}
+
+void test_malformed_payload()
+{
+    AolonDecoder d = makeDecoder();
+    const uint8_t bad[] = {0xFE, 0xEA, 0x20, 0x07, 0x6B, 97, 98};
+    d.feed(bad, sizeof(bad), 0);
+    TEST_ASSERT_EQUAL_INT(-1, seen.spo2);
+    TEST_ASSERT_EQUAL_UINT32(1, d.stats().malformed);
+    // Frame berikutnya tetap terbaca
+    d.feed(SPO2_97, sizeof(SPO2_97), 10);
+    TEST_ASSERT_EQUAL_INT(97, seen.spo2);
+}
+
+void test_stale_partial_discarded()
+{
+    AolonDecoder d = makeDecoder();
+    // Notifikasi lanjutan hilang: sisa frame tidak boleh menelan frame baru
+    d.feed(STRESS_42, 6, 0);
+    d.feed(SPO2_97, sizeof(SPO2_97), AOLON_FRAME_GAP_MS + 1);
+    TEST_ASSERT_EQUAL_INT(97, seen.spo2);
+    TEST_ASSERT_EQUAL_INT(-1, seen.stress);
+    TEST_ASSERT_EQUAL_UINT32(6, d.stats().discarded);
+}
+
+void test_partial_within_gap_kept()
+{
+    AolonDecoder d = makeDecoder();
+    d.feed(STRESS_42, 6, 0);
+    d.feed(STRESS_42 + 6, sizeof(STRESS_42) - 6, AOLON_FRAME_GAP_MS);
+    TEST_ASSERT_EQUAL_INT(42, seen.stress);
+    TEST_ASSERT_EQUAL_UINT32(0, d.stats().discarded);
+}
+
+void test_reset_drops_partial()
+{
+    AolonDecoder d = makeDecoder();
+    d.feed(STRESS_42, 6, 0);
+    d.reset();
+    d.feed(SPO2_97, sizeof(SPO2_97), 10);
+    TEST_ASSERT_EQUAL_INT(97, seen.spo2);
+    TEST_ASSERT_EQUAL_INT(-1, seen.stress);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_whole_frame);
+    RUN_TEST(test_split_frame);
+    RUN_TEST(test_merged_frames);
+    RUN_TEST(test_resync_after_garbage);
+    RUN_TEST(test_malformed_payload);
+    RUN_TEST(test_stale_partial_discarded);
+    RUN_TEST(test_partial_within_gap_kept);
+    RUN_TEST(test_reset_drops_partial);
+    return UNITY_END();
+}
@@ -0,0 +1,250 @@
+#include <unity.h>
+#include <journal.h>
+
+// Storage di RAM dengan semantik flash NOR (write hanya 1 -> 0, erase
+// per sektor), supaya isi blok bisa dirusak langsung oleh test
+class MemStorage : public JournalStorage
+{
+public:
+    MemStorage(uint32_t size, uint32_t sector) : bytes(size), sector(sector), syncs(0), erases(0)
+    {
+        memset(mem, 0xFF, sizeof(mem));
+    }
+
+    bool read(uint32_t offset, uint8_t *buf, size_t len) override
+    {
+        if (offset + len > bytes)
+            return false;
+        memcpy(buf, &mem[offset], len);
+        return true;
+    }
+    bool write(uint32_t offset, const uint8_t *buf, size_t len) override
+    {
+        if (offset + len > bytes)
+            return false;
+        for (size_t i = 0; i < len; i++)
+            mem[offset + i] &= buf[i];
+        return true;
+    }
+    bool erase(uint32_t offset, size_t len) override
+    {
+        if (offset % sector || len % sector || offset + len > bytes)
+            return false;
+        memset(&mem[offset], 0xFF, len);
+        erases++;
+        return true;
+    }
+    bool sync() override
+    {
+        syncs++;
+        return true;
+    }
+    uint32_t size() const override { return bytes; }
+    uint32_t eraseSize() const override { return sector; }
+
+    uint8_t mem[512];
+    uint32_t bytes;
+    uint32_t sector;
+    uint32_t syncs;
+    uint32_t erases;
+};
+
+// Sektor 64 byte: 8 entry header per sektor log, 3 record per sektor.
+// 2 sektor header + 3 sektor record = 9 slot.
+static constexpr uint32_t SECTOR = 64;
+static constexpr uint32_t PER_SECTOR = SECTOR / Journal::RECORD_LEN;
+static constexpr uint32_t SLOTS = 3 * PER_SECTOR;
+static constexpr uint32_t STORAGE_LEN = (Journal::HEADER_SECTORS + 3) * SECTOR;
+
+void setUp() {}
+void tearDown() {}
+
+static UplinkItem makeItem(uint8_t value)
+{
+    UplinkItem item = {};
+    item.data.device_id = 11;
+    item.data.topic = Topic::HEART_RATE;
+    item.data.sensor.value = value;
+    item.timestamp = 1700000000 + value;
+    return item;
+}
+
+static uint32_t recordOffset(uint32_t seq)
+{
+    uint32_t slot = seq % SLOTS;
+    return (Journal::HEADER_SECTORS + slot / PER_SECTOR) * SECTOR + (slot % PER_SECTOR) * Journal::RECORD_LEN;
+}
+
+static void assertPending(Journal &j, uint8_t first, uint32_t count)
+{
+    TEST_ASSERT_EQUAL_UINT32(count, j.pending());
+    UplinkItem item;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        TEST_ASSERT_TRUE(j.read(i, item));
+        TEST_ASSERT_EQUAL_UINT8(first + i, item.data.sensor.value);
+        TEST_ASSERT_EQUAL_UINT32(1700000000 + first + i, item.timestamp);
+    }
+    TEST_ASSERT_FALSE(j.read(count, item));
+}
+
+void test_append_replay_order()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    TEST_ASSERT_EQUAL_UINT32(SLOTS - PER_SECTOR, j.capacity());
+    for (uint8_t v = 1; v <= 5; v++)
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+    assertPending(j, 1, 5);
+
+    TEST_ASSERT_TRUE(j.consume(2));
+    assertPending(j, 3, 3);
+
+    // Setelah reboot urutan dan posisi baca tetap sama
+    Journal after(storage);
+    TEST_ASSERT_TRUE(after.begin());
+    assertPending(after, 3, 3);
+}
+
+void test_sync_batched()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    for (uint8_t v = 1; v <= 5; v++)
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+    TEST_ASSERT_TRUE(j.consume(2));
+    // append/consume tidak sync sendiri, sync() sekali untuk semuanya
+    TEST_ASSERT_EQUAL_UINT32(0, storage.syncs);
+    TEST_ASSERT_TRUE(j.sync());
+    TEST_ASSERT_TRUE(j.sync());
+    TEST_ASSERT_EQUAL_UINT32(1, storage.syncs);
+}
+
+void test_torn_last_record()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    for (uint8_t v = 1; v <= 4; v++)
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+
+    // Crash di tengah append record ke-4: ekor record masih ter-erase
+    memset(&storage.mem[recordOffset(4) + 12], 0xFF, Journal::RECORD_LEN - 12);
+
+    Journal after(storage);
+    TEST_ASSERT_TRUE(after.begin());
+    assertPending(after, 1, 3);
+    // Slot yang terpotong tidak bisa ditulis ulang tanpa erase, jadi seq-nya
+    // dilewati dan record baru masuk slot berikutnya
+    TEST_ASSERT_TRUE(after.append(makeItem(9)));
+    UplinkItem item;
+    TEST_ASSERT_EQUAL_UINT32(5, after.pending());
+    TEST_ASSERT_FALSE(after.read(3, item));
+    TEST_ASSERT_TRUE(after.read(4, item));
+    TEST_ASSERT_EQUAL_UINT8(9, item.data.sensor.value);
+    // Slot kosong di tail dilewati saat consume
+    TEST_ASSERT_TRUE(after.consume(3));
+    assertPending(after, 9, 1);
+}
+
+void test_wraparound_overwrites_oldest_sector()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    // Seq 9 masuk slot 0 (sektor pertama, berisi seq 1-2), seq 12 masuk
+    // sektor kedua (seq 3-5): keduanya di-erase dan record lama hilang
+    for (uint8_t v = 1; v <= 12; v++)
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+    TEST_ASSERT_EQUAL_UINT32(5, j.overwritten());
+    assertPending(j, 6, 7);
+
+    Journal after(storage);
+    TEST_ASSERT_TRUE(after.begin());
+    assertPending(after, 6, 7);
+}
+
+void test_consume_through_after_overwrite()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    for (uint8_t v = 1; v <= 8; v++)
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+
+    // Batch replay seq 1..3 in-flight, lalu journal penuh menghapus seq 1..2
+    uint32_t lastSeq = j.tail() + 2;
+    TEST_ASSERT_TRUE(j.append(makeItem(9)));
+    TEST_ASSERT_EQUAL_UINT32(3, j.tail());
+
+    // Hanya seq 3 yang dibuang, record 4.. yang belum terkirim tetap ada
+    TEST_ASSERT_TRUE(j.consumeThrough(lastSeq));
+    assertPending(j, 4, 6);
+    // Seq yang sudah lewat tidak menggeser tail lagi
+    TEST_ASSERT_TRUE(j.consumeThrough(lastSeq));
+    assertPending(j, 4, 6);
+}
+
+void test_header_log_alternation()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    // 20 consume: sektor log 0 (8 entry), sektor 1 (8 entry), lalu sektor 0
+    // di-erase dan dipakai lagi untuk 4 entry
+    for (uint8_t v = 1; v <= 20; v++)
+    {
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+        TEST_ASSERT_TRUE(j.consume(1));
+    }
+    // Sektor lama tetap berisi entry valid sampai sektor itu dipakai lagi
+    TEST_ASSERT_EQUAL_HEX8(0x5A, storage.mem[SECTOR]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, storage.mem[4 * Journal::HEADER_LEN]);
+
+    TEST_ASSERT_TRUE(j.append(makeItem(21)));
+    TEST_ASSERT_TRUE(j.append(makeItem(22)));
+    TEST_ASSERT_TRUE(j.consume(1));
+    // Crash saat menulis entry terbaru: entry sebelumnya masih berlaku
+    memset(&storage.mem[4 * Journal::HEADER_LEN + 3], 0xFF, Journal::HEADER_LEN - 3);
+    Journal after(storage);
+    TEST_ASSERT_TRUE(after.begin());
+    assertPending(after, 21, 2);
+
+    // Entry terpotong dilewati, entry baru ditulis setelahnya
+    TEST_ASSERT_TRUE(after.consume(1));
+    Journal again(storage);
+    TEST_ASSERT_TRUE(again.begin());
+    assertPending(again, 22, 1);
+}
+
+void test_garbage_storage()
+{
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    // Partisi bekas: isi acak, bukan 0xFF
+    for (uint32_t i = 0; i < STORAGE_LEN; i++)
+        storage.mem[i] = (uint8_t)(i * 37 + 11);
+    Journal j(storage);
+    TEST_ASSERT_TRUE(j.begin());
+    TEST_ASSERT_EQUAL_UINT32(0, j.pending());
+    for (uint8_t v = 1; v <= 4; v++)
+        TEST_ASSERT_TRUE(j.append(makeItem(v)));
+    TEST_ASSERT_TRUE(j.consume(1));
+    Journal after(storage);
+    TEST_ASSERT_TRUE(after.begin());
+    assertPending(after, 2, 3);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_append_replay_order);
+    RUN_TEST(test_sync_batched);
+    RUN_TEST(test_torn_last_record);
+    RUN_TEST(test_wraparound_overwrites_oldest_sector);
+    RUN_TEST(test_consume_through_after_overwrite);
+    RUN_TEST(test_header_log_alternation);
+    RUN_TEST(test_garbage_storage);
+    return UNITY_END();
+}
@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <uplink_queue.h>
+#include <vector>
+
+// Urutan pembacaan yang diterima API saat antrian RAM pindah ke journal.
+// HttpPipeline memakai WiFiClient palsu dari test/native/WiFi.h.
+
+class MemStorage : public JournalStorage
+{
+public:
+    MemStorage(uint32_t size, uint32_t sector) : mem(size, 0xFF), sector(sector) {}
+
+    bool read(uint32_t offset, uint8_t *buf, size_t len) override
+    {
+        if (offset + len > mem.size())
+            return false;
+        memcpy(buf, &mem[offset], len);
+        return true;
+    }
+    bool write(uint32_t offset, const uint8_t *buf, size_t len) override
+    {
+        if (offset + len > mem.size())
+            return false;
+        for (size_t i = 0; i < len; i++)
+            mem[offset + i] &= buf[i];
+        return true;
+    }
+    bool erase(uint32_t offset, size_t len) override
+    {
+        if (offset % sector || len % sector || offset + len > mem.size())
+            return false;
+        memset(&mem[offset], 0xFF, len);
+        return true;
+    }
+    bool sync() override { return true; }
+    uint32_t size() const override { return mem.size(); }
+    uint32_t eraseSize() const override { return sector; }
+
+    std::vector<uint8_t> mem;
+    uint32_t sector;
+};
+
+// 16 sektor record x 12 record = 192 slot, cukup untuk semua pembacaan test
+static constexpr uint32_t SECTOR = 256;
+static constexpr uint32_t STORAGE_LEN = (Journal::HEADER_SECTORS + 16) * SECTOR;
+static constexpr uint32_t RETRY_MS = 50;
+
+void setUp()
+{
+    fakeServer.up = true;
+    fakeServer.status = 200;
+    fakeServer.answered.clear();
+}
+void tearDown() {}
+
+static void pushReading(UplinkQueue &q, uint32_t timestamp)
+{
+    DeviceData data = {};
+    data.device_id = 7;
+    data.topic = Topic::HEART_RATE;
+    data.sensor.value = 70;
+    TEST_ASSERT_TRUE(q.push(data, timestamp, millis()));
+}
+
+// Jalankan loop() sampai cond terpenuhi (connect berjalan di thread lain)
+template <typename Cond>
+static void loopUntil(UplinkQueue &q, Cond cond)
+{
+    uint32_t start = millis();
+    while (!cond())
+    {
+        TEST_ASSERT_TRUE(millis() - start < 3000);
+        q.loop(millis());
+        delay(1);
+    }
+}
+
+// Timestamp semua pembacaan yang dijawab 2xx, urut sesuai response
+static std::vector<uint32_t> postedTimestamps()
+{
+    std::vector<uint32_t> out;
+    for (const FakeRequest &req : fakeServer.answered)
+    {
+        if (req.status != 200)
+            continue;
+        const char *p = req.body.c_str();
+        while ((p = strstr(p, "\"timestamp\":")))
+        {
+            p += 12;
+            out.push_back(strtoul(p, nullptr, 10));
+        }
+    }
+    return out;
+}
+
+static void assertInOrder(uint32_t count)
+{
+    std::vector<uint32_t> ts = postedTimestamps();
+    TEST_ASSERT_EQUAL_UINT32(count, ts.size());
+    for (uint32_t i = 0; i < count; i++)
+        TEST_ASSERT_EQUAL_UINT32(i, ts[i]);
+}
+
+void test_overflow_spills_oldest_first()
+{
+    HttpPipeline http("api", 80, 4, 10000);
+    HttpPipeline sos("api", 80, 1, 10000);
+    UplinkQueue q(http, sos, "/data", "/sos", 4, 0, RETRY_MS);
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal journal(storage);
+    TEST_ASSERT_TRUE(journal.begin());
+    q.attachJournal(&journal, 0);
+
+    // Server menahan response: batch RAM in-flight, antrian terus terisi
+    fakeServer.status = 0;
+    uint32_t ts = 0;
+    for (; ts < 10; ts++)
+        pushReading(q, ts);
+    loopUntil(q, [&]() { return q.stats().inFlight == 3; });
+
+    // Antrian RAM penuh (64): semuanya pindah ke journal sebelum pembacaan baru
+    for (; ts < 80; ts++)
+        pushReading(q, ts);
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats().queued);
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats().dropped);
+
+    fakeServer.status = 200;
+    loopUntil(q, [&]() { return q.stats().posted == ts; });
+    TEST_ASSERT_EQUAL_UINT32(0, journal.pending());
+    assertInOrder(ts);
+}
+
+void test_failed_post_spills_oldest_first()
+{
+    HttpPipeline http("api", 80, 4, 10000);
+    HttpPipeline sos("api", 80, 1, 10000);
+    UplinkQueue q(http, sos, "/data", "/sos", 4, 0, RETRY_MS);
+    MemStorage storage(STORAGE_LEN, SECTOR);
+    Journal journal(storage);
+    TEST_ASSERT_TRUE(journal.begin());
+    q.attachJournal(&journal, 0);
+
+    fakeServer.status = 0;
+    uint32_t ts = 0;
+    for (; ts < 14; ts++)
+        pushReading(q, ts);
+    loopUntil(q, [&]() { return q.stats().inFlight == 4; });
+
+    // POST gagal: antrian RAM (in-flight dan sisanya) pindah ke journal,
+    // pembacaan berikutnya antre di belakangnya
+    fakeServer.status = 500;
+    loopUntil(q, [&]() { return q.stats().failed > 0; });
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats().queued);
+    TEST_ASSERT_EQUAL_UINT32(ts, journal.pending());
+    for (; ts < 30; ts++)
+        pushReading(q, ts);
+
+    fakeServer.status = 200;
+    loopUntil(q, [&]() { return journal.empty() && !q.stats().inFlight && !q.stats().queued; });
+    assertInOrder(ts);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_overflow_spills_oldest_first);
+    RUN_TEST(test_failed_post_spills_oldest_first);
+    return UNITY_END();
+}